@@ -0,0 +1,236 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arrow.h"
+
+// Type of the observation times
+enum {ARROW_TIMES_DOUBLE, ARROW_TIMES_TIMESTAMP};
+
+// Operator to apply, with its parameters
+typedef struct {
+  rolling_operator rolling_op;    // operator with a rolling time window (or NULL)
+  ema_operator ema_op;            // EMA (or NULL)
+  const double *width_before;
+  const double *width_after;
+  const double *tau;
+} arrow_operator;
+
+// Buffers of an exported array, which are freed by its release callback
+typedef struct {
+  const void *buffers[2];         // validity bitmap (or NULL) and values
+  uint8_t *validity;
+  double *values;
+} arrow_private;
+
+
+/******************* Helper functions ********************/
+
+// Return 1 if element i of an array is valid (i.e. not null), and 0 otherwise
+static inline int arrow_is_valid(const struct ArrowArray *array, int64_t i)
+{
+  const uint8_t *validity = array->buffers[0];
+  int64_t j = array->offset + i;
+  
+  return (validity == NULL) || ((validity[j >> 3] >> (j & 7)) & 1);
+}
+
+
+// Return the type of the observation times (or -1 if not supported)
+static int arrow_times_type(const struct ArrowSchema *schema)
+{
+  const char *format = schema->format;
+  
+  if (strcmp(format, "g") == 0)
+    return ARROW_TIMES_DOUBLE;
+  if ((strncmp(format, "ts", 2) == 0) && (format[2] != '\0') && (strchr("smun", format[2]) != NULL) &&
+    (format[3] == ':'))
+    return ARROW_TIMES_TIMESTAMP;
+  return -1;
+}
+
+
+// Check that an array is a valid, non-nested array with a single data buffer
+static int arrow_check_array(const struct ArrowSchema *schema, const struct ArrowArray *array)
+{
+  return (schema->release != NULL) && (schema->n_children == 0) && (schema->dictionary == NULL) &&
+    (array->release != NULL) && (array->n_buffers == 2) && (array->n_children == 0) && (array->offset >= 0) &&
+    (array->length >= 0) && ((array->buffers[1] != NULL) || (array->length == 0));
+}
+
+
+static void arrow_release_schema(struct ArrowSchema *schema)
+{
+  schema->release = NULL;
+}
+
+
+static void arrow_release_array(struct ArrowArray *array)
+{
+  arrow_private *private_data = array->private_data;
+  
+  free(private_data->validity);
+  free(private_data->values);
+  free(private_data);
+  array->release = NULL;
+}
+
+
+// Apply an operator to a time series stored in arrays
+static void arrow_operator_apply(const arrow_operator *op, const double values[], const double times[], int n,
+  double values_new[])
+{
+  if (op->rolling_op != NULL)
+    op->rolling_op(values, times, &n, values_new, op->width_before, op->width_after);
+  else
+    op->ema_op(values, times, &n, values_new, op->tau);
+}
+
+/****************** END: Helper functions ****************/
+
+
+/*
+Apply an operator to a time series given as Arrow arrays
+-) float64 values and times are passed directly to the operator, without a copy, unless there are null values
+   or times. The observations with null values or times are skipped by applying the operator to a packed copy of
+   the remaining observations. Timestamps are converted to doubles relative to the first valid timestamp, which is
+   exact for time spans below 2^53 units (e.g. about 104 days for timestamp[ns]).
+-) the output is a float64 array in the buffers of this library, which is owned by the caller and needs to be
+   released via array_out->release(array_out) (and schema_out->release(schema_out))
+-) the input arrays are neither modified nor released
+*/
+static int arrow_apply(const arrow_operator *op, const struct ArrowSchema *schema_values,
+  const struct ArrowArray *array_values, const struct ArrowSchema *schema_times, const struct ArrowArray *array_times,
+  struct ArrowSchema *schema_out, struct ArrowArray *array_out)
+{
+  int times_type = arrow_times_type(schema_times), n, num_valid = 0, has_nulls;
+  const double *values, *times;
+  double *values_packed = NULL, *times_packed = NULL;
+  arrow_private *private_data;
+  
+  // Check input
+  if ((strcmp(schema_values->format, "g") != 0) || (times_type < 0) ||
+    !arrow_check_array(schema_values, array_values) || !arrow_check_array(schema_times, array_times))
+    return ARROW_STATUS_INVALID_TYPE;
+  if ((array_values->length != array_times->length) || (array_values->length > INT_MAX))
+    return ARROW_STATUS_INVALID_LENGTH;
+  n = (int) array_values->length;
+  values = (const double *) array_values->buffers[1] + array_values->offset;
+  times = (const double *) array_times->buffers[1] + array_times->offset;
+  has_nulls = ((array_values->null_count != 0) && (array_values->buffers[0] != NULL)) ||
+    ((array_times->null_count != 0) && (array_times->buffers[0] != NULL));
+  
+  // Allocate output
+  if ((private_data = calloc(1, sizeof(arrow_private))) == NULL)
+    return ARROW_STATUS_OUT_OF_MEMORY;
+  if (((private_data->values = malloc((n > 0 ? n : 1) * sizeof(double))) == NULL) ||
+    (has_nulls && ((private_data->validity = calloc(n / 8 + 1, 1)) == NULL))) {
+    free(private_data->values);
+    free(private_data);
+    return ARROW_STATUS_OUT_OF_MEMORY;
+  }
+  
+  // Pack the valid observations, and convert timestamps to doubles
+  if (has_nulls || (times_type == ARROW_TIMES_TIMESTAMP)) {
+    const int64_t *timestamps = (const int64_t *) array_times->buffers[1] + array_times->offset;
+    int64_t timestamp_first = 0;
+  
+    values_packed = malloc((n > 0 ? n : 1) * sizeof(double));
+    times_packed = malloc((n > 0 ? n : 1) * sizeof(double));
+    if ((values_packed == NULL) || (times_packed == NULL)) {
+      free(values_packed);
+      free(times_packed);
+      free(private_data->validity);
+      free(private_data->values);
+      free(private_data);
+      return ARROW_STATUS_OUT_OF_MEMORY;
+    }
+    for (int i = 0; i < n; i++) {
+      if (has_nulls && (!arrow_is_valid(array_values, i) || !arrow_is_valid(array_times, i)))
+        continue;
+      if (times_type == ARROW_TIMES_TIMESTAMP) {
+        if (num_valid == 0)
+          timestamp_first = timestamps[i];
+        times_packed[num_valid] = (double) (timestamps[i] - timestamp_first);
+      } else
+        times_packed[num_valid] = times[i];
+      values_packed[num_valid] = values[i];
+      if (has_nulls)
+        private_data->validity[i >> 3] |= (uint8_t) (1 << (i & 7));
+      num_valid++;
+    }
+    values = values_packed;
+    times = times_packed;
+  } else
+    num_valid = n;
+  
+  // Apply operator, and move the output values of the valid observations to their positions (from the end,
+  // because an observation is never moved to a position before its position in the packed arrays)
+  arrow_operator_apply(op, values, times, num_valid, private_data->values);
+  if (has_nulls) {
+    for (int i = n - 1, j = num_valid - 1; i >= 0; i--)
+      private_data->values[i] = ((private_data->validity[i >> 3] >> (i & 7)) & 1) ? private_data->values[j--] : NAN;
+  }
+  free(values_packed);
+  free(times_packed);
+  
+  // Export output
+  private_data->buffers[0] = private_data->validity;
+  private_data->buffers[1] = private_data->values;
+  memset(array_out, 0, sizeof(struct ArrowArray));
+  array_out->length = n;
+  array_out->null_count = n - num_valid;
+  array_out->n_buffers = 2;
+  array_out->buffers = private_data->buffers;
+  array_out->release = arrow_release_array;
+  array_out->private_data = private_data;
+  
+  memset(schema_out, 0, sizeof(struct ArrowSchema));
+  schema_out->format = "g";
+  schema_out->name = "";
+  schema_out->flags = ARROW_FLAG_NULLABLE;
+  schema_out->release = arrow_release_schema;
+  return ARROW_STATUS_OK;
+}
+
+
+/*
+Apply an operator with a rolling time window (e.g. rolling_sum or sma_linear) to a time series given as Arrow
+arrays, and return ARROW_STATUS_OK on success
+-) see arrow_apply() for details
+*/
+int arrow_rolling(rolling_operator op, const struct ArrowSchema *schema_values, const struct ArrowArray *array_values,
+  const struct ArrowSchema *schema_times, const struct ArrowArray *array_times, const double *width_before,
+  const double *width_after, struct ArrowSchema *schema_out, struct ArrowArray *array_out)
+{
+  // op            ... operator, e.g. rolling_sum
+  // schema_values ... schema of time series values (float64)
+  // array_values  ... array of time series values
+  // schema_times  ... schema of observation times (float64 or timestamp)
+  // array_times   ... array of observation times
+  // width_before  ... (non-negative) width of rolling window before t_i
+  // width_after   ... (non-negative) width of rolling window after t_i
+  // schema_out    ... schema of output (float64)
+  // array_out     ... array of output values
+  
+  arrow_operator arrow_op = {op, NULL, width_before, width_after, NULL};
+  
+  return arrow_apply(&arrow_op, schema_values, array_values, schema_times, array_times, schema_out, array_out);
+}
+
+
+// Apply an EMA (e.g. ema_linear) to a time series given as Arrow arrays, see arrow_rolling()
+int arrow_ema(ema_operator op, const struct ArrowSchema *schema_values, const struct ArrowArray *array_values,
+  const struct ArrowSchema *schema_times, const struct ArrowArray *array_times, const double *tau,
+  struct ArrowSchema *schema_out, struct ArrowArray *array_out)
+{
+  // op  ... operator, e.g. ema_linear
+  // tau ... (positive) half-life of EMA kernel
+  
+  arrow_operator arrow_op = {NULL, op, NULL, NULL, tau};
+  
+  return arrow_apply(&arrow_op, schema_values, array_values, schema_times, array_times, schema_out, array_out);
+}
@@ -0,0 +1,83 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+#ifndef _arrow_h
+#define _arrow_h
+
+#include <stdint.h>
+#include "parallel.h"
+
+/*
+Structs of the Apache Arrow C Data Interface (https://arrow.apache.org/docs/format/CDataInterface.html), which
+are part of the specification and therefore defined here instead of depending on an Arrow library
+*/
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+#endif
+
+
+/*
+Arrow interface: apply an operator to a time series given as two Arrow arrays of the same length (e.g. two
+columns of a pyarrow table, a DuckDB result or a Polars data frame), and export the output as an Arrow array
+-) values: float64 (format "g"); times: float64, or timestamp with any unit and time zone (format "tss:...",
+   "tsm:...", "tsu:..." or "tsn:..."), in which case the window widths and half-lives are in the same unit as
+   the timestamps (e.g. nanoseconds for timestamp[ns])
+-) observations with a null value or time are skipped, i.e. the operator is applied to the remaining
+   observations, and the output is null for the skipped observations
+-) see arrow_rolling() for details
+*/
+
+// Status of the Arrow interface
+enum {
+  ARROW_STATUS_OK,
+  ARROW_STATUS_INVALID_TYPE,
+  ARROW_STATUS_INVALID_LENGTH,
+  ARROW_STATUS_OUT_OF_MEMORY
+};
+
+int arrow_rolling(rolling_operator op, const struct ArrowSchema *schema_values, const struct ArrowArray *array_values,
+  const struct ArrowSchema *schema_times, const struct ArrowArray *array_times, const double *width_before,
+  const double *width_after, struct ArrowSchema *schema_out, struct ArrowArray *array_out);
+int arrow_ema(ema_operator op, const struct ArrowSchema *schema_values, const struct ArrowArray *array_values,
+  const struct ArrowSchema *schema_times, const struct ArrowArray *array_times, const double *tau,
+  struct ArrowSchema *schema_out, struct ArrowArray *array_out);
+
+#endif
@@ -0,0 +1,662 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+/*
+Benchmark of the operators in ema.h, sma.h and rolling.h on synthetic unevenly spaced time series
+-) every operator is run for each input generator, number of observations, and window width (or half-life), and
+   the results are printed as tab-separated lines with a header, so that runs for different commits can be
+   compared with standard tools, e.g. "./bench > bench_output.txt"
+-) usage: ./bench [max_n] [prefix], where 'max_n' is the largest number of observations (default 1000000), and
+   only operators whose name starts with 'prefix' are run (default all)
+-) the number of memory allocations per call is only counted if the program is compiled with
+   -DBENCH_COUNT_ALLOCS and linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc (see README_Linux.md),
+   and is reported as -1 otherwise
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ema.h"
+#include "sma.h"
+#include "rolling.h"
+#include "parallel.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/******************* Allocation counting ********************/
+
+static long bench_num_allocs = 0;      // number of calls to malloc, calloc and realloc
+static long bench_bytes_allocs = 0;    // number of requested bytes
+
+#ifdef BENCH_COUNT_ALLOCS
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+  bench_num_allocs++;
+  bench_bytes_allocs += size;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size)
+{
+  bench_num_allocs++;
+  bench_bytes_allocs += num * size;
+  return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  bench_num_allocs++;
+  bench_bytes_allocs += size;
+  return __real_realloc(ptr, size);
+}
+#endif
+
+/****************** END: Allocation counting ****************/
+
+
+
+/******************* Input generators ********************/
+
+// Return a pseudo-random number uniformly distributed in (0, 1), using a xorshift64* generator, so that the
+// inputs are the same on all platforms
+static double bench_random(uint64_t *state)
+{
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return ((*state * 2685821657736338717ULL >> 11) + 0.5) / 9007199254740992.0;
+}
+
+
+// Return a pseudo-random number with an exponential distribution with the given mean
+static double bench_exponential(uint64_t *state, double mean)
+{
+  return -mean * log(bench_random(state));
+}
+
+
+// Random walk observation values with uniformly distributed increments
+static void bench_random_walk(double values[], int n, uint64_t *state)
+{
+  values[0] = 100;
+  for (int i = 1; i < n; i++)
+    values[i] = values[i-1] + bench_random(state) - 0.5;
+}
+
+
+/*
+Observation times of a Poisson process with unit rate, i.e. exponentially distributed time differences with
+mean one
+*/
+static void generate_poisson(double values[], double times[], int n, uint64_t *state)
+{
+  times[0] = 0;
+  for (int i = 1; i < n; i++)
+    times[i] = times[i-1] + bench_exponential(state, 1);
+  bench_random_walk(values, n, state);
+}
+
+
+/*
+Observation times of a self-exciting (Hawkes) process with exponential kernel and unit long-run rate, i.e. bursts
+of closely spaced observations separated by quiet periods, as e.g. for trades in a financial market
+-) the intensity is mu + alpha * sum(exp(-beta * (t - t_j))) over all previous observation times t_j, with a
+   branching ratio alpha / beta = 0.8, and is simulated exactly via thinning (Ogata 1981)
+*/
+static void generate_hawkes(double values[], double times[], int n, uint64_t *state)
+{
+  const double mu = 0.2, alpha = 4, beta = 5;
+  double t = 0, excitation = 0;   // current time, and sum(alpha * exp(-beta * (t - t_j)))
+  
+  times[0] = 0;
+  excitation = alpha;
+  for (int i = 1; i < n; i++) {
+    while (1) {
+      // The intensity decreases between observations, so the current intensity is an upper bound
+      double bound = mu + excitation;
+      double dt = bench_exponential(state, 1 / bound);
+      t += dt;
+      excitation *= exp(-beta * dt);
+      if (bench_random(state) * bound <= mu + excitation)
+        break;
+    }
+    times[i] = t;
+    excitation += alpha;
+  }
+  bench_random_walk(values, n, state);
+}
+
+
+// Regularly spaced observation times with unit spacing, as e.g. for one-minute bars
+static void generate_regular(double values[], double times[], int n, uint64_t *state)
+{
+  for (int i = 0; i < n; i++)
+    times[i] = i;
+  bench_random_walk(values, n, state);
+}
+
+
+/*
+Adversarial input for operators that rescan or recalculate the time window: steadily falling values, which make
+every observation a candidate for the rolling maximum, with a zero every 100 observations, which has to be
+divided out of (or recalculated for) the rolling product when it leaves the time window
+-) the observation times are those of a Poisson process, see generate_poisson()
+*/
+static void generate_monotone(double values[], double times[], int n, uint64_t *state)
+{
+  generate_poisson(values, times, n, state);
+  for (int i = 0; i < n; i++)
+    values[i] = (i % 100 == 99) ? 0 : 1 + (n - i) * 1e-6;
+}
+
+
+typedef void (*bench_generator)(double values[], double times[], int n, uint64_t *state);
+
+static const struct {
+  const char *name;
+  bench_generator generate;
+} bench_generators[] = {
+  {"poisson", generate_poisson},
+  {"hawkes", generate_hawkes},
+  {"regular", generate_regular},
+  {"monotone", generate_monotone}
+};
+
+/****************** END: Input generators ****************/
+
+
+
+/******************* Benchmark cases ********************/
+
+// Input of a single benchmark run, with all auxiliary arrays needed by the various operators
+typedef struct {
+  int n;                  // number of observations
+  double *values;         // observation values
+  double *times;          // observation times
+  int n_y;                // number of observations of second time series (for sma_cov_* etc.)
+  double *values_y;       // observation values of second time series
+  double *times_y;        // observation times of second time series
+  int n_out;              // number of output times (for *_at)
+  double *times_out;      // regularly spaced output times
+  int *lefts;             // window plan (for *_plan)
+  int *rights;
+  double width;           // width_before of rolling time windows, and half-life of EMAs
+} bench_input;
+
+// Signatures of the operators (in addition to rolling_operator and ema_operator in parallel.h)
+typedef void (*window_parallel_operator)(const double values[], const double times[], const int *n,
+  double values_new[], const double *width_before, const double *width_after, const int *num_threads);
+typedef void (*window_multi_operator)(const double values[], const double times[], const int *n,
+  double values_new[], const double widths_before[], const double widths_after[], const int *num_widths);
+typedef void (*window_at_operator)(const double values[], const double times[], const int *n,
+  const double times_out[], const int *n_out, double values_new[], const double *width_before,
+  const double *width_after);
+typedef void (*sma_plan_operator)(const double values[], const double times[], const int lefts[],
+  const int rights[], const int *n, double values_new[], const double *width_before, const double *width_after);
+typedef void (*sma_pair_operator)(const double values_x[], const double times_x[], const int *n_x,
+  const double values_y[], const double times_y[], const int *n_y, double values_new[],
+  const double *width_before, const double *width_after);
+typedef void (*ema_parallel_operator)(const double values[], const double times[], const int *n,
+  double values_new[], const double *tau, const int *num_threads);
+typedef void (*ema_multi_operator)(const double values[], const double times[], const int *n,
+  double values_new[], const double taus[], const int *num_taus);
+typedef void (*ema_at_operator)(const double values[], const double times[], const int *n,
+  const double times_out[], const int *n_out, double values_new[], const double *tau);
+typedef void (*ema_accuracy_operator)(const double values[], const double times[], const int *n,
+  double values_new[], const double *tau, const int *accuracy);
+typedef void (*bench_function)(const bench_input *input, double values_new[], int arg);
+
+/*
+A benchmark case, i.e. an operator together with its arguments other than the input time series
+-) exactly one of the function pointers is set, and determines how the operator is called (see bench_call)
+-) 'arg' is an additional argument for some operators, e.g. the accuracy mode for ema_next_accuracy()
+*/
+typedef struct {
+  const char *name;
+  rolling_operator window;
+  window_parallel_operator window_parallel;
+  window_multi_operator window_multi;
+  window_at_operator window_at;
+  rolling_plan_operator window_plan;
+  sma_plan_operator sma_plan;
+  sma_pair_operator sma_pair;
+  ema_operator ema;
+  ema_parallel_operator ema_parallel;
+  ema_multi_operator ema_multi;
+  ema_at_operator ema_at;
+  ema_accuracy_operator ema_accuracy;
+  bench_function other;
+  int arg;
+} bench_case;
+
+
+static void bench_rolling_central_moment(const bench_input *input, double values_new[], int arg)
+{
+  double width_after = 0, m = arg;
+  rolling_central_moment(input->values, input->times, &input->n, values_new, &input->width, &width_after, &m);
+}
+
+
+static void bench_rolling_central_moment_plan(const bench_input *input, double values_new[], int arg)
+{
+  double m = arg;
+  rolling_central_moment_plan(input->values, input->lefts, input->rights, &input->n, values_new, &m);
+}
+
+
+static void bench_rolling_quantile(const bench_input *input, double values_new[], int arg)
+{
+  double width_after = 0, probs[] = {0.1, 0.5, 0.9};
+  int num_probs = 3;
+  rolling_quantile(input->values, input->times, &input->n, values_new, &input->width, &width_after, probs,
+    &num_probs);
+}
+
+
+static void bench_rolling_stats(const bench_input *input, double values_new[], int arg)
+{
+  double width_after = 0;
+  rolling_stats(input->values, input->times, &input->n, values_new, &input->width, &width_after, &arg);
+}
+
+
+static void bench_rolling_aggregate(const bench_input *input, double values_new[], int arg)
+{
+  double width_after = 0, identity = -INFINITY;
+  rolling_aggregate(input->values, input->times, &input->n, values_new, &input->width, &width_after, fmax,
+    &identity);
+}
+
+
+// Maximum of two doubles, as an operation for rolling_aggregate_generic()
+static void combine_max(void *result, const void *a, const void *b, void *context)
+{
+  *(double *) result = fmax(*(const double *) a, *(const double *) b);
+}
+
+
+static void bench_rolling_aggregate_generic(const bench_input *input, double values_new[], int arg)
+{
+  double width_after = 0, identity = -INFINITY;
+  int size = sizeof(double);
+  rolling_aggregate_generic(input->values, input->times, &input->n, values_new, &size, &input->width,
+    &width_after, combine_max, &identity, NULL);
+}
+
+
+static void bench_rolling_at(const bench_input *input, double values_new[], int arg)
+{
+  double width_after = 0;
+  rolling_at(input->values, input->times, &input->n, input->times_out, &input->n_out, values_new, &arg,
+    &input->width, &width_after);
+}
+
+
+static void bench_rolling_plan(const bench_input *input, double values_new[], int arg)
+{
+  double width_after = 0;
+  rolling_plan(input->times, &input->n, &input->width, &width_after, input->lefts, input->rights);
+}
+
+
+static void bench_rolling_num_obs_plan(const bench_input *input, double values_new[], int arg)
+{
+  rolling_num_obs_plan(input->lefts, input->rights, &input->n, values_new);
+}
+
+
+// Streaming interface of the rolling operator 'arg'
+static void bench_rolling_stream(const bench_input *input, double values_new[], int arg)
+{
+  rolling_stream *stream = rolling_stream_new(&arg, &input->width);
+  if (stream == NULL)
+    return;
+  for (int i = 0; i < input->n; i++)
+    values_new[i] = rolling_stream_push(stream, &input->times[i], &input->values[i]);
+  rolling_stream_free(stream);
+}
+
+
+// Streaming interface of EMA_next (arg = 0), EMA_last (arg = 1), or EMA_linear (arg = 2)
+static void bench_ema_stream(const bench_input *input, double values_new[], int arg)
+{
+  ema_state state;
+  
+  if (arg == 0) {
+    ema_next_init(&state, &input->width);
+    for (int i = 0; i < input->n; i++)
+      values_new[i] = ema_next_update(&state, &input->times[i], &input->values[i]);
+  } else if (arg == 1) {
+    ema_last_init(&state, &input->width);
+    for (int i = 0; i < input->n; i++)
+      values_new[i] = ema_last_update(&state, &input->times[i], &input->values[i]);
+  } else {
+    ema_linear_init(&state, &input->width);
+    for (int i = 0; i < input->n; i++)
+      values_new[i] = ema_linear_update(&state, &input->times[i], &input->values[i]);
+  }
+}
+
+
+// Maximum number of output values per observation of any benchmark case (e.g. three half-lives for *_multi)
+#define BENCH_MAX_OUTPUTS 7
+
+static const bench_case bench_cases[] = {
+  // rolling.h
+  {"rolling_num_obs", .window = rolling_num_obs},
+  {"rolling_sum", .window = rolling_sum},
+  {"rolling_sum_stable", .window = rolling_sum_stable},
+  {"rolling_product", .window = rolling_product},
+  {"rolling_mean", .window = rolling_mean},
+  {"rolling_max", .window = rolling_max},
+  {"rolling_min", .window = rolling_min},
+  {"rolling_median", .window = rolling_median},
+  {"rolling_sd", .window = rolling_sd},
+  {"rolling_var", .window = rolling_var},
+  {"rolling_central_moment(3)", .other = bench_rolling_central_moment, .arg = 3},
+  {"rolling_central_moment(5)", .other = bench_rolling_central_moment, .arg = 5},
+  {"rolling_quantile(3)", .other = bench_rolling_quantile},
+  {"rolling_stats(7)", .other = bench_rolling_stats, .arg = (1 << ROLLING_NUM_OBS) | (1 << ROLLING_SUM) |
+    (1 << ROLLING_MEAN) | (1 << ROLLING_MAX) | (1 << ROLLING_MIN) | (1 << ROLLING_SD) | (1 << ROLLING_VAR)},
+  {"rolling_aggregate(fmax)", .other = bench_rolling_aggregate},
+  {"rolling_aggregate_generic(max)", .other = bench_rolling_aggregate_generic},
+  {"rolling_sum_multi(3)", .window_multi = rolling_sum_multi},
+  {"rolling_mean_multi(3)", .window_multi = rolling_mean_multi},
+  {"rolling_num_obs_parallel", .window_parallel = rolling_num_obs_parallel},
+  {"rolling_sum_parallel", .window_parallel = rolling_sum_parallel},
+  {"rolling_sum_stable_parallel", .window_parallel = rolling_sum_stable_parallel},
+  {"rolling_product_parallel", .window_parallel = rolling_product_parallel},
+  {"rolling_mean_parallel", .window_parallel = rolling_mean_parallel},
+  {"rolling_max_parallel", .window_parallel = rolling_max_parallel},
+  {"rolling_min_parallel", .window_parallel = rolling_min_parallel},
+  {"rolling_median_parallel", .window_parallel = rolling_median_parallel},
+  {"rolling_sd_parallel", .window_parallel = rolling_sd_parallel},
+  {"rolling_var_parallel", .window_parallel = rolling_var_parallel},
+  {"rolling_at(sum)", .other = bench_rolling_at, .arg = ROLLING_SUM},
+  {"rolling_at(median)", .other = bench_rolling_at, .arg = ROLLING_MEDIAN},
+  {"rolling_plan", .other = bench_rolling_plan},
+  {"rolling_num_obs_plan", .other = bench_rolling_num_obs_plan},
+  {"rolling_sum_plan", .window_plan = rolling_sum_plan},
+  {"rolling_sum_stable_plan", .window_plan = rolling_sum_stable_plan},
+  {"rolling_product_plan", .window_plan = rolling_product_plan},
+  {"rolling_mean_plan", .window_plan = rolling_mean_plan},
+  {"rolling_max_plan", .window_plan = rolling_max_plan},
+  {"rolling_min_plan", .window_plan = rolling_min_plan},
+  {"rolling_median_plan", .window_plan = rolling_median_plan},
+  {"rolling_sd_plan", .window_plan = rolling_sd_plan},
+  {"rolling_var_plan", .window_plan = rolling_var_plan},
+  {"rolling_central_moment_plan(3)", .other = bench_rolling_central_moment_plan, .arg = 3},
+  {"rolling_stream(sum)", .other = bench_rolling_stream, .arg = ROLLING_SUM},
+  {"rolling_stream(product)", .other = bench_rolling_stream, .arg = ROLLING_PRODUCT},
+  {"rolling_stream(max)", .other = bench_rolling_stream, .arg = ROLLING_MAX},
+  {"rolling_stream(median)", .other = bench_rolling_stream, .arg = ROLLING_MEDIAN},
+  {"rolling_stream(var)", .other = bench_rolling_stream, .arg = ROLLING_VAR},
+
+  // sma.h
+  {"sma_last", .window = sma_last},
+  {"sma_next", .window = sma_next},
+  {"sma_linear", .window = sma_linear},
+  {"sma_last_regular", .window = sma_last_regular},
+  {"sma_next_regular", .window = sma_next_regular},
+  {"sma_linear_regular", .window = sma_linear_regular},
+  {"sma_last_multi(3)", .window_multi = sma_last_multi},
+  {"sma_next_multi(3)", .window_multi = sma_next_multi},
+  {"sma_linear_multi(3)", .window_multi = sma_linear_multi},
+  {"sma_last_parallel", .window_parallel = sma_last_parallel},
+  {"sma_next_parallel", .window_parallel = sma_next_parallel},
+  {"sma_linear_parallel", .window_parallel = sma_linear_parallel},
+  {"sma_last_at", .window_at = sma_last_at},
+  {"sma_next_at", .window_at = sma_next_at},
+  {"sma_linear_at", .window_at = sma_linear_at},
+  {"sma_last_plan", .sma_plan = sma_last_plan},
+  {"sma_next_plan", .sma_plan = sma_next_plan},
+  {"sma_linear_plan", .sma_plan = sma_linear_plan},
+  {"sma_cov_last", .sma_pair = sma_cov_last},
+  {"sma_cov_next", .sma_pair = sma_cov_next},
+  {"sma_cov_linear", .sma_pair = sma_cov_linear},
+  {"sma_cor_last", .sma_pair = sma_cor_last},
+  {"sma_cor_next", .sma_pair = sma_cor_next},
+  {"sma_cor_linear", .sma_pair = sma_cor_linear},
+  {"sma_beta_last", .sma_pair = sma_beta_last},
+  {"sma_beta_next", .sma_pair = sma_beta_next},
+  {"sma_beta_linear", .sma_pair = sma_beta_linear},
+
+  // ema.h
+  {"ema_next", .ema = ema_next},
+  {"ema_last", .ema = ema_last},
+  {"ema_linear", .ema = ema_linear},
+  {"ema_next_multi(3)", .ema_multi = ema_next_multi},
+  {"ema_last_multi(3)", .ema_multi = ema_last_multi},
+  {"ema_linear_multi(3)", .ema_multi = ema_linear_multi},
+  {"ema_next_parallel", .ema_parallel = ema_next_parallel},
+  {"ema_last_parallel", .ema_parallel = ema_last_parallel},
+  {"ema_linear_parallel", .ema_parallel = ema_linear_parallel},
+  {"ema_next_at", .ema_at = ema_next_at},
+  {"ema_last_at", .ema_at = ema_last_at},
+  {"ema_linear_at", .ema_at = ema_linear_at},
+  {"ema_next_accuracy(1e-12)", .ema_accuracy = ema_next_accuracy, .arg = EMA_APPROX_1E12},
+  {"ema_next_accuracy(1e-7)", .ema_accuracy = ema_next_accuracy, .arg = EMA_APPROX_1E7},
+  {"ema_last_accuracy(1e-12)", .ema_accuracy = ema_last_accuracy, .arg = EMA_APPROX_1E12},
+  {"ema_last_accuracy(1e-7)", .ema_accuracy = ema_last_accuracy, .arg = EMA_APPROX_1E7},
+  {"ema_linear_accuracy(1e-12)", .ema_accuracy = ema_linear_accuracy, .arg = EMA_APPROX_1E12},
+  {"ema_linear_accuracy(1e-7)", .ema_accuracy = ema_linear_accuracy, .arg = EMA_APPROX_1E7},
+  {"ema_next_stream", .other = bench_ema_stream, .arg = 0},
+  {"ema_last_stream", .other = bench_ema_stream, .arg = 1},
+  {"ema_linear_stream", .other = bench_ema_stream, .arg = 2}
+};
+
+
+// Call the operator of a benchmark case once
+static void bench_call(const bench_case *bc, const bench_input *input, double values_new[])
+{
+  // bc         ... benchmark case
+  // input      ... input time series and auxiliary arrays
+  // values_new ... array of length BENCH_MAX_OUTPUTS * input->n to store output
+  
+  const double width_after = 0;
+  const double widths_before[] = {input->width / 4, input->width, input->width * 4}, widths_after[] = {0, 0, 0};
+  const int num_threads = 4, num_widths = 3;
+  
+  if (bc->window)
+    bc->window(input->values, input->times, &input->n, values_new, &input->width, &width_after);
+  else if (bc->window_parallel)
+    bc->window_parallel(input->values, input->times, &input->n, values_new, &input->width, &width_after,
+      &num_threads);
+  else if (bc->window_multi)
+    bc->window_multi(input->values, input->times, &input->n, values_new, widths_before, widths_after,
+      &num_widths);
+  else if (bc->window_at)
+    bc->window_at(input->values, input->times, &input->n, input->times_out, &input->n_out, values_new,
+      &input->width, &width_after);
+  else if (bc->window_plan)
+    bc->window_plan(input->values, input->lefts, input->rights, &input->n, values_new);
+  else if (bc->sma_plan)
+    bc->sma_plan(input->values, input->times, input->lefts, input->rights, &input->n, values_new, &input->width,
+      &width_after);
+  else if (bc->sma_pair)
+    bc->sma_pair(input->values, input->times, &input->n, input->values_y, input->times_y, &input->n_y, values_new,
+      &input->width, &width_after);
+  else if (bc->ema)
+    bc->ema(input->values, input->times, &input->n, values_new, &input->width);
+  else if (bc->ema_parallel)
+    bc->ema_parallel(input->values, input->times, &input->n, values_new, &input->width, &num_threads);
+  else if (bc->ema_multi)
+    bc->ema_multi(input->values, input->times, &input->n, values_new, widths_before, &num_widths);
+  else if (bc->ema_at)
+    bc->ema_at(input->values, input->times, &input->n, input->times_out, &input->n_out, values_new, &input->width);
+  else if (bc->ema_accuracy)
+    bc->ema_accuracy(input->values, input->times, &input->n, values_new, &input->width, &bc->arg);
+  else
+    bc->other(input, values_new, bc->arg);
+}
+
+/****************** END: Benchmark cases ****************/
+
+
+
+/******************* Benchmark driver ********************/
+
+// Minimum run-time of each measurement in seconds. Fast operators are called repeatedly until it is reached.
+#define BENCH_MIN_SECONDS 0.02
+
+
+// Return the current time in seconds
+// -) wall-clock time with OpenMP, because clock() adds up the CPU time of all threads of the *_parallel operators
+static double bench_seconds(void)
+{
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+/*
+Generate the input time series and auxiliary arrays for a given generator, number of observations and window
+width (return 1 if successful, and 0 if out of memory)
+-) the second time series (for sma_cov_* etc.) has the same distribution, but different observation times
+-) the output times (for *_at) are regularly spaced, with half as many output times as observations
+*/
+static int bench_input_new(bench_input *input, bench_generator generate, int n, double width)
+{
+  uint64_t state = 88172645463325252ULL;
+  double width_after = 0;
+  
+  input->n = input->n_y = n;
+  input->n_out = (n + 1) / 2;
+  input->width = width;
+  input->values = malloc(n * sizeof(double));
+  input->times = malloc(n * sizeof(double));
+  input->values_y = malloc(n * sizeof(double));
+  input->times_y = malloc(n * sizeof(double));
+  input->times_out = malloc(input->n_out * sizeof(double));
+  input->lefts = malloc(n * sizeof(int));
+  input->rights = malloc(n * sizeof(int));
+  if (!input->values || !input->times || !input->values_y || !input->times_y || !input->times_out ||
+    !input->lefts || !input->rights)
+    return 0;
+  
+  generate(input->values, input->times, n, &state);
+  generate(input->values_y, input->times_y, n, &state);
+  for (int i = 0; i < input->n_out; i++)
+    input->times_out[i] = input->times[0] + (input->times[n-1] - input->times[0]) * i / input->n_out;
+  rolling_plan(input->times, &input->n, &input->width, &width_after, input->lefts, input->rights);
+  return 1;
+}
+
+
+static void bench_input_free(bench_input *input)
+{
+  free(input->values);
+  free(input->times);
+  free(input->values_y);
+  free(input->times_y);
+  free(input->times_out);
+  free(input->lefts);
+  free(input->rights);
+}
+
+
+// Return the sum of the finite output values, as a simple check that results are unchanged across commits
+static double bench_checksum(const double values_new[], int n)
+{
+  double sum = 0;
+  for (int i = 0; i < n; i++) {
+    if (isfinite(values_new[i]))
+      sum += values_new[i];
+  }
+  return sum;
+}
+
+
+/*
+Measure the run-time and memory allocations of a single benchmark case for a given input, and print the result
+-) output columns: operator, generator, number of observations, window width (or half-life) in units of the
+   average time difference between observations, number of calls, nanoseconds per observation, millions of
+   observations per second, allocations and allocated bytes per call, and a checksum of the output
+*/
+static void bench_run(const bench_case *bc, const char *generator, const bench_input *input, double values_new[])
+{
+  int reps = 0;
+  long num_allocs, bytes_allocs;
+  double seconds, start;
+  
+  // Initialize output, so that operators that do not set all output values give reproducible checksums
+  memset(values_new, 0, BENCH_MAX_OUTPUTS * input->n * sizeof(double));
+  
+  num_allocs = bench_num_allocs;
+  bytes_allocs = bench_bytes_allocs;
+  start = bench_seconds();
+  do {
+    bench_call(bc, input, values_new);
+    reps++;
+    seconds = bench_seconds() - start;
+  } while (seconds < BENCH_MIN_SECONDS);
+  num_allocs = bench_num_allocs - num_allocs;
+  bytes_allocs = bench_bytes_allocs - bytes_allocs;
+  
+#ifdef BENCH_COUNT_ALLOCS
+  num_allocs /= reps;
+  bytes_allocs /= reps;
+#else
+  num_allocs = bytes_allocs = -1;
+#endif
+  printf("%s\t%s\t%d\t%g\t%d\t%.2f\t%.2f\t%ld\t%ld\t%.17g\n", bc->name, generator, input->n, input->width, reps,
+    seconds / reps / input->n * 1e9, reps * (double) input->n / seconds / 1e6, num_allocs, bytes_allocs,
+    bench_checksum(values_new, BENCH_MAX_OUTPUTS * input->n));
+  fflush(stdout);
+}
+
+
+int main(int argc, char *argv[])
+{
+  int max_n = (argc > 1) ? atoi(argv[1]) : 1000000;
+  const char *prefix = (argc > 2) ? argv[2] : "";
+  const int ns[] = {1000, 100000, 1000000, 10000000};
+  const double widths[] = {10, 1000};
+  int num_gens = sizeof(bench_generators) / sizeof(bench_generators[0]);
+  int num_cases = sizeof(bench_cases) / sizeof(bench_cases[0]);
+  
+  printf("operator\tgenerator\tn\twidth\tcalls\tns_per_obs\tmobs_per_sec\tallocs_per_call\tbytes_per_call\t"
+    "checksum\n");
+  for (int k = 0; k < (int) (sizeof(ns) / sizeof(int)); k++) {
+    if (ns[k] > max_n)
+      break;
+    double *values_new = malloc(BENCH_MAX_OUTPUTS * ns[k] * sizeof(double));
+    if (values_new == NULL) {
+      fprintf(stderr, "Out of memory for n = %d\n", ns[k]);
+      return 1;
+    }
+  
+    for (int g = 0; g < num_gens; g++) {
+      for (int w = 0; w < (int) (sizeof(widths) / sizeof(double)); w++) {
+        bench_input input;
+        if (!bench_input_new(&input, bench_generators[g].generate, ns[k], widths[w])) {
+          fprintf(stderr, "Out of memory for n = %d\n", ns[k]);
+          return 1;
+        }
+        for (int c = 0; c < num_cases; c++) {
+          if (strncmp(bench_cases[c].name, prefix, strlen(prefix)) == 0)
+            bench_run(&bench_cases[c], bench_generators[g].name, &input, values_new);
+        }
+        bench_input_free(&input);
+      }
+    }
+    free(values_new);
+  }
+  return 0;
+}
+
+/****************** END: Benchmark driver ****************/
@@ -0,0 +1,359 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+// Needed for mmap(), ftruncate() and madvise(), which are not part of C99
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "columnar.h"
+
+#if !defined(_WIN32) && !defined(COLUMNAR_NO_MMAP)
+#  define COLUMNAR_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#define COLUMNAR_ALIGNMENT 64            // alignment of columns in bytes (size of a cache line)
+#define COLUMNAR_VERSION 1
+#define COLUMNAR_BYTE_ORDER 0x01020304
+
+static const char columnar_magic[8] = {'U', 'T', 'S', 'C', 'O', 'L', 0, 0};
+
+/*
+Header at the start of a file, followed by the columns
+-) column 0 (the observation times) starts at byte 64, and column k + 1 (the values of column k) starts at byte
+   64 + (k + 1) * column_stride
+-) the space between the end of a column and the start of the next column is filled with zeros
+*/
+typedef struct {
+  char magic[8];            // "UTSCOL" followed by two zero bytes
+  uint32_t version;         // version of file format
+  uint32_t byte_order;      // COLUMNAR_BYTE_ORDER in the byte order of the writing machine
+  int64_t n;                // number of observations
+  int64_t num_columns;      // number of value columns
+  int64_t column_stride;    // distance between the start of consecutive columns in bytes (multiple of 64)
+  char reserved[24];        // zero
+} columnar_header;
+
+// An open file
+struct columnar_file {
+  char *data;               // contents of the file (memory-mapped, or read into memory)
+  size_t size;              // size of the contents in bytes
+  long long n;              // number of observations
+  int num_columns;          // number of value columns
+  size_t column_stride;     // distance between the start of consecutive columns in bytes
+  char *path;               // path of a file created with columnar_create() (only without memory-mapping)
+};
+
+
+/******************* Helper functions ********************/
+
+// Calculate the distance between the start of consecutive columns, and the size of a file in bytes
+// (returns 0 on success, and -1 if the file would be too large for the address space)
+static int columnar_layout(long long n, long long num_columns, size_t *column_stride, size_t *size)
+{
+  if ((n < 0) || (num_columns < 0) || (num_columns > INT_MAX))
+    return -1;
+  if ((unsigned long long) n > (SIZE_MAX - COLUMNAR_ALIGNMENT) / sizeof(double))
+    return -1;
+  *column_stride = ((size_t) n * sizeof(double) + COLUMNAR_ALIGNMENT - 1) / COLUMNAR_ALIGNMENT * COLUMNAR_ALIGNMENT;
+  if ((*column_stride > 0) &&
+    ((unsigned long long) num_columns + 1 > (SIZE_MAX - sizeof(columnar_header)) / *column_stride))
+    return -1;
+  *size = sizeof(columnar_header) + ((size_t) num_columns + 1) * *column_stride;
+  return 0;
+}
+
+
+// Initialize the header of a file with 'n' observations and 'num_columns' value columns
+static void columnar_header_init(columnar_header *header, long long n, int num_columns, size_t column_stride)
+{
+  memset(header, 0, sizeof(columnar_header));
+  memcpy(header->magic, columnar_magic, sizeof(columnar_magic));
+  header->version = COLUMNAR_VERSION;
+  header->byte_order = COLUMNAR_BYTE_ORDER;
+  header->n = n;
+  header->num_columns = num_columns;
+  header->column_stride = (int64_t) column_stride;
+}
+
+
+// Check the header of a file, and fill in the corresponding fields of 'file'
+// (returns 0 on success, and -1 if the header is invalid or the file is too short)
+static int columnar_header_read(const columnar_header *header, size_t size, columnar_file *file)
+{
+  // size ... size of the file in bytes (or SIZE_MAX if not known yet)
+  
+  size_t column_stride, size_needed;
+  
+  if ((memcmp(header->magic, columnar_magic, sizeof(columnar_magic)) != 0) ||
+    (header->version != COLUMNAR_VERSION) || (header->byte_order != COLUMNAR_BYTE_ORDER))
+    return -1;
+  if (columnar_layout(header->n, header->num_columns, &column_stride, &size_needed) != 0)
+    return -1;
+  if ((header->column_stride != (int64_t) column_stride) || (size < size_needed))
+    return -1;
+  
+  file->size = size_needed;
+  file->n = header->n;
+  file->num_columns = (int) header->num_columns;
+  file->column_stride = column_stride;
+  return 0;
+}
+
+
+#ifdef COLUMNAR_MMAP
+// Pass the access hints in 'flags' to the kernel (failures are ignored, because the hints are optional)
+static void columnar_advise(void *data, size_t size, int flags)
+{
+  if (flags & COLUMNAR_SEQUENTIAL)
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+#  ifdef MADV_HUGEPAGE
+  if (flags & COLUMNAR_HUGE_PAGES)
+    madvise(data, size, MADV_HUGEPAGE);
+#  endif
+}
+#else
+// Write the contents of a file (returns 0 on success, and -1 on failure)
+static int columnar_save(const char *path, const char *data, size_t size)
+{
+  FILE *stream = fopen(path, "wb");
+  int status = 0;
+  
+  if (stream == NULL)
+    return -1;
+  if (fwrite(data, 1, size, stream) != size)
+    status = -1;
+  if (fclose(stream) != 0)
+    status = -1;
+  return status;
+}
+#endif
+
+/****************** END: Helper functions ****************/
+
+
+/*
+Open a file for reading, and return NULL on failure (with errno set to EINVAL if the file is not a valid
+columnar file)
+-) the file is memory-mapped, so only the parts that are accessed are read from disk
+-) the columns may be modified in memory (e.g. to sort or clean the observations), but changes are not written
+   to the file
+-) flags: a combination of COLUMNAR_SEQUENTIAL and COLUMNAR_HUGE_PAGES, or 0. Huge pages for file-backed
+   mappings are only used if the kernel supports them for the file system of the file (e.g. tmpfs mounted with
+   huge=always).
+*/
+columnar_file *columnar_open(const char *path, const int *flags)
+{
+  // path  ... path of file
+  // flags ... access hints for the kernel
+  
+  columnar_file *file = calloc(1, sizeof(columnar_file));
+  columnar_header header;
+  if (file == NULL)
+    return NULL;
+  
+#ifdef COLUMNAR_MMAP
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    free(file);
+    return NULL;
+  }
+  errno = 0;
+  if ((fstat(fd, &st) != 0) || (read(fd, &header, sizeof(header)) != (ssize_t) sizeof(header)) ||
+    (columnar_header_read(&header, (size_t) st.st_size, file) != 0)) {
+    if (errno == 0)
+      errno = EINVAL;
+    close(fd);
+    free(file);
+    return NULL;
+  }
+  
+  // Private mapping, so that changes in memory are not written to the file
+  file->data = mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (file->data == MAP_FAILED) {
+    free(file);
+    return NULL;
+  }
+  columnar_advise(file->data, file->size, *flags);
+#else
+  (void) flags;
+  FILE *stream = fopen(path, "rb");
+  if (stream == NULL) {
+    free(file);
+    return NULL;
+  }
+  errno = 0;
+  if ((fread(&header, sizeof(header), 1, stream) != 1) || (columnar_header_read(&header, SIZE_MAX, file) != 0) ||
+    ((file->data = malloc(file->size)) == NULL) || (fseek(stream, 0, SEEK_SET) != 0) ||
+    (fread(file->data, 1, file->size, stream) != file->size)) {
+    if ((file->data != NULL) || (errno == 0))
+      errno = EINVAL;
+    fclose(stream);
+    free(file->data);
+    free(file);
+    return NULL;
+  }
+  fclose(stream);
+#endif
+  return file;
+}
+
+
+/*
+Create a file with '*n' observations and '*num_columns' value columns for writing, and return NULL on failure
+-) the columns are initialized with zeros, and can be used as output arrays of the operators, e.g.
+   rolling_sum(..., columnar_values(file, &k), ...), without an intermediate copy
+-) the file is complete once columnar_close() has been called
+*/
+columnar_file *columnar_create(const char *path, const long long *n, const int *num_columns, const int *flags)
+{
+  // path        ... path of file (an existing file is overwritten)
+  // n           ... number of observations
+  // num_columns ... number of value columns
+  // flags       ... access hints for the kernel, see columnar_open()
+  
+  columnar_file *file = calloc(1, sizeof(columnar_file));
+  columnar_header header;
+  if (file == NULL)
+    return NULL;
+  if (columnar_layout(*n, *num_columns, &file->column_stride, &file->size) != 0) {
+    errno = EINVAL;
+    free(file);
+    return NULL;
+  }
+  file->n = *n;
+  file->num_columns = *num_columns;
+  columnar_header_init(&header, *n, *num_columns, file->column_stride);
+  
+#ifdef COLUMNAR_MMAP
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    free(file);
+    return NULL;
+  }
+  if ((ftruncate(fd, (off_t) file->size) != 0) ||
+    ((file->data = mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+    close(fd);
+    free(file);
+    return NULL;
+  }
+  close(fd);
+  columnar_advise(file->data, file->size, *flags);
+#else
+  (void) flags;
+  if (((file->data = calloc(file->size, 1)) == NULL) || ((file->path = malloc(strlen(path) + 1)) == NULL)) {
+    free(file->data);
+    free(file);
+    return NULL;
+  }
+  strcpy(file->path, path);
+#endif
+  memcpy(file->data, &header, sizeof(header));
+  return file;
+}
+
+
+// Close a file opened with columnar_open() or columnar_create() (returns 0 on success, and -1 if the contents
+// of a created file could not be written)
+int columnar_close(columnar_file *file)
+{
+  int status = 0;
+  
+  if (file == NULL)
+    return 0;
+#ifdef COLUMNAR_MMAP
+  if (munmap(file->data, file->size) != 0)
+    status = -1;
+#else
+  if (file->path != NULL)
+    status = columnar_save(file->path, file->data, file->size);
+  free(file->path);
+  free(file->data);
+#endif
+  free(file);
+  return status;
+}
+
+
+// Number of observations
+long long columnar_length(const columnar_file *file)
+{
+  return file->n;
+}
+
+
+// Number of value columns
+int columnar_num_columns(const columnar_file *file)
+{
+  return file->num_columns;
+}
+
+
+// Array of observation times
+double *columnar_times(columnar_file *file)
+{
+  return (double *) (file->data + sizeof(columnar_header));
+}
+
+
+// Array of values of a column (NULL if there is no such column)
+double *columnar_values(columnar_file *file, const int *column)
+{
+  // column ... number of value column, starting at 0
+  
+  if ((*column < 0) || (*column >= file->num_columns))
+    return NULL;
+  return (double *) (file->data + sizeof(columnar_header) + (size_t) (*column + 1) * file->column_stride);
+}
+
+
+/*
+Write a time series with one or more value columns to a file (returns 0 on success, and -1 on failure)
+-) the value columns are stored consecutively in 'values', i.e. in the same layout as the output of the *_multi
+   functions
+*/
+int columnar_write(const char *path, const double times[], const double values[], const int *n,
+  const int *num_columns)
+{
+  // path        ... path of file (an existing file is overwritten)
+  // times       ... array of observation times
+  // values      ... array of length (*n) * (*num_columns) of time series values, column by column
+  // n           ... number of observations, i.e. length of 'times'
+  // num_columns ... number of value columns
+  
+  static const char padding[COLUMNAR_ALIGNMENT] = {0};
+  columnar_header header;
+  size_t column_stride, size, num_padding;
+  FILE *stream;
+  int status = 0;
+  
+  if (columnar_layout(*n, *num_columns, &column_stride, &size) != 0)
+    return -1;
+  if ((stream = fopen(path, "wb")) == NULL)
+    return -1;
+  
+  // Header and columns, each followed by padding up to the start of the next column
+  columnar_header_init(&header, *n, *num_columns, column_stride);
+  num_padding = column_stride - (size_t) *n * sizeof(double);
+  if (fwrite(&header, sizeof(header), 1, stream) != 1)
+    status = -1;
+  for (int k = -1; (k < *num_columns) && (status == 0); k++) {
+    const double *column = (k < 0) ? times : values + (size_t) k * *n;
+    if ((fwrite(column, sizeof(double), *n, stream) != (size_t) *n) ||
+      (fwrite(padding, 1, num_padding, stream) != num_padding))
+      status = -1;
+  }
+  if (fclose(stream) != 0)
+    status = -1;
+  return status;
+}
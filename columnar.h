@@ -0,0 +1,45 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+// Remark: To facilitate interfaces to other programming languages such as R, all variables are either pointers or arrays
+
+#ifndef _columnar_h
+#define _columnar_h
+
+/*
+Binary columnar file format for unevenly spaced time series, which can be memory-mapped and passed to the
+operators without parsing or copying
+-) a 64-byte header (see columnar.c), followed by the observation times and one or more columns of values that
+   share these observation times, each stored as an array of doubles starting at a multiple of 64 bytes
+-) the numbers are stored in the byte order of the writing machine, and files with a different byte order are
+   rejected by the reader
+-) the columns of a file opened with columnar_open() can be passed directly to the operators, e.g.
+   rolling_sum(columnar_values(file, &k), columnar_times(file), &n, ...), and the output can be written directly
+   into the columns of a file created with columnar_create()
+-) time series with more observations than the range of an int can be processed in consecutive slices of the
+   columns with the chunked interface (see rolling_chunked_push() and sma_chunked_push())
+-) on platforms without mmap() (e.g. Windows), or if compiled with -DCOLUMNAR_NO_MMAP, the file is read into
+   memory instead (so the columns only have the alignment of malloc()), and files created with columnar_create()
+   are written when they are closed
+*/
+
+// Flags for columnar_open() and columnar_create(), which can be combined with "|"
+enum {
+  COLUMNAR_SEQUENTIAL = 1,    // hint that the file will be read from start to end (more aggressive read-ahead)
+  COLUMNAR_HUGE_PAGES = 2     // hint to use transparent huge pages for the mapping, where supported (Linux)
+};
+
+typedef struct columnar_file columnar_file;
+
+columnar_file *columnar_open(const char *path, const int *flags);
+columnar_file *columnar_create(const char *path, const long long *n, const int *num_columns, const int *flags);
+int columnar_close(columnar_file *file);
+
+long long columnar_length(const columnar_file *file);
+int columnar_num_columns(const columnar_file *file);
+double *columnar_times(columnar_file *file);
+double *columnar_values(columnar_file *file, const int *column);
+
+int columnar_write(const char *path, const double times[], const double values[], const int *n,
+  const int *num_columns);
+
+#endif
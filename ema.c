@@ -2,7 +2,196 @@
 // License: GPL-2 | GPL-3
 
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 #include "ema.h"
+#include "stats.h"
+
+
+/******************* Helper functions ********************/
+
+// Single step of the EMA_next recursion
+static inline double ema_next_step(double ema_old, double value_old, double value, double delta, double tau)
+{
+  // ema_old   ... EMA value at previous observation time
+  // value_old ... previous observation value (unused, but keeps the signature of all three steps identical)
+  // value     ... current observation value
+  // delta     ... time difference between current and previous observation
+  // tau       ... (positive) half-life of EMA kernel
+  
+  (void) value_old;
+  double w = exp(-delta / tau);
+  return ema_old * w + value * (1-w);
+}
+
+
+// Single step of the EMA_last recursion
+static inline double ema_last_step(double ema_old, double value_old, double value, double delta, double tau)
+{
+  (void) value;
+  double w = exp(-delta / tau);
+  return ema_old * w + value_old * (1-w);
+}
+
+
+// Weights of the EMA_linear recursion for a time difference 'delta'
+static inline void ema_linear_weights(double delta, double tau, double *w, double *w2)
+{
+  double tmp = delta / tau;
+  
+  *w = exp(-tmp);
+  if (tmp > 1e-6)
+    *w2 = (1 - *w) / tmp;
+  else {
+    // Use Taylor expansion for numerical stability
+    *w2 = 1 - tmp/2 + tmp*tmp/6 - tmp*tmp*tmp/24;
+    STATS_ADD(taylor_steps, 1);
+  }
+}
+
+
+// Single step of the EMA_linear recursion
+static inline double ema_linear_step(double ema_old, double value_old, double value, double delta, double tau)
+{
+  double w, w2;
+  
+  ema_linear_weights(delta, tau, &w, &w2);
+  return ema_old * w + value * (1 - w2) + value_old * (w2 - w);
+}
+
+
+/*
+Exponential function for non-positive arguments, written without branches or library calls, so that the
+compiler can vectorize loops that call it (e.g. with -O3 -mavx2 or -O3 -mavx512f)
+-) range reduction exp(x) = 2^k * exp(r) with |r| <= log(2)/2, followed by a degree 13 Taylor polynomial
+-) the relative error is at most about one ulp compared to exp() from the C library
+-) returns 0 for arguments below -708, where exp() would return a subnormal number or zero
+-) comparisons are done on the bit patterns, because the compiler does not if-convert (and hence does not
+   vectorize) floating-point comparisons, which might raise exceptions for NANs
+*/
+static inline double exp_nonpositive(double x)
+{
+  const double shift = 0x1.8p52;   // adding this constant rounds to an integer, stored in the lowest mantissa bits
+  const double ln2_hi = 0x1.62e42feep-1, ln2_lo = 0x1.a39ef35793c76p-33;   // k * ln2_hi is exact
+  const double x_min = -708;
+  double kd, r, p, scale;
+  uint64_t ki, x_bits, x_min_bits, underflow;
+  
+  // Replace arguments below x_min by x_min, using that the bit pattern of a negative double increases with
+  // its absolute value
+  memcpy(&x_bits, &x, sizeof(double));
+  memcpy(&x_min_bits, &x_min, sizeof(double));
+  underflow = -(uint64_t) (x_bits > x_min_bits);   // all bits set if x < x_min
+  x_bits = (x_bits & ~underflow) | (x_min_bits & underflow);
+  memcpy(&x, &x_bits, sizeof(double));
+  
+  // Write x = k * log(2) + r
+  kd = x * 0x1.71547652b82fep0 + shift;
+  memcpy(&ki, &kd, sizeof(double));
+  kd -= shift;
+  r = (x - kd * ln2_hi) - kd * ln2_lo;
+  
+  // Taylor polynomial of exp(r) in Horner form
+  p = 1.0 / 6227020800;
+  p = p * r + 1.0 / 479001600;
+  p = p * r + 1.0 / 39916800;
+  p = p * r + 1.0 / 3628800;
+  p = p * r + 1.0 / 362880;
+  p = p * r + 1.0 / 40320;
+  p = p * r + 1.0 / 5040;
+  p = p * r + 1.0 / 720;
+  p = p * r + 1.0 / 120;
+  p = p * r + 1.0 / 24;
+  p = p * r + 1.0 / 6;
+  p = p * r + 0.5;
+  p = p * r + 1;
+  p = p * r + 1;
+  
+  // Multiply with 2^k by constructing the exponent bits directly (zero in case of underflow)
+  ki = ((ki + 1023) << 52) & ~underflow;
+  memcpy(&scale, &ki, sizeof(double));
+  return p * scale;
+}
+
+
+/*
+exp(x) - 1 for non-positive arguments, written without branches or library calls like exp_nonpositive(), but
+with a Taylor polynomial of selectable degree, and with a small relative error also for arguments close to zero,
+where calculating exp(x) - 1 directly would lose precision
+-) range reduction exp(x) = 2^k * exp(r) with |r| <= log(2)/2, so that exp(x) - 1 = 2^k * (exp(r) - 1) + (2^k - 1)
+-) the relative error is at most (log(2)/2)^degree / (degree + 1)! plus a few ulp, i.e. about 6.3e-13 for
+   degree 10 and 1.5e-8 for degree 7
+-) returns -1 for arguments below -708
+*/
+static inline double expm1_nonpositive(double x, int degree)
+{
+  // degree ... degree of Taylor polynomial (between 1 and 13)
+  
+  static const double inv_factorial[] = {1, 1, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+    1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600, 1.0 / 6227020800};
+  const double shift = 0x1.8p52;   // see exp_nonpositive()
+  const double ln2_hi = 0x1.62e42feep-1, ln2_lo = 0x1.a39ef35793c76p-33;
+  const double x_min = -708;
+  double kd, r, p, scale;
+  uint64_t ki, x_bits, x_min_bits, underflow;
+  
+  // Replace arguments below x_min by x_min (see exp_nonpositive)
+  memcpy(&x_bits, &x, sizeof(double));
+  memcpy(&x_min_bits, &x_min, sizeof(double));
+  underflow = -(uint64_t) (x_bits > x_min_bits);
+  x_bits = (x_bits & ~underflow) | (x_min_bits & underflow);
+  memcpy(&x, &x_bits, sizeof(double));
+  
+  // Write x = k * log(2) + r
+  kd = x * 0x1.71547652b82fep0 + shift;
+  memcpy(&ki, &kd, sizeof(double));
+  kd -= shift;
+  r = (x - kd * ln2_hi) - kd * ln2_lo;
+  
+  // Taylor polynomial of exp(r) - 1 in Horner form
+  p = inv_factorial[degree];
+  for (int j = degree - 1; j >= 1; j--)
+    p = p * r + inv_factorial[j];
+  p = p * r;
+  
+  // Multiply with 2^k by constructing the exponent bits directly (zero in case of underflow)
+  ki = ((ki + 1023) << 52) & ~underflow;
+  memcpy(&scale, &ki, sizeof(double));
+  return scale * p + (scale - 1);
+}
+
+
+// Same as the weight 'w2' in ema_linear_step(), but evaluate both branches and select the result via bit
+// operations, so that loops calling this function can be vectorized (see exp_nonpositive)
+static inline double ema_linear_weight_nonbranching(double tmp, double one_minus_w)
+{
+  // tmp         ... (non-negative) time difference divided by half-life
+  // one_minus_w ... 1 - exp(-tmp)
+  
+  const double tmp_min = 1e-6;
+  double w2, w2_taylor;
+  uint64_t tmp_bits, tmp_min_bits, w2_bits, w2_taylor_bits, small;
+  
+  w2 = one_minus_w / tmp;
+  w2_taylor = 1 - tmp/2 + tmp*tmp/6 - tmp*tmp*tmp/24;   // Taylor expansion for numerical stability
+  
+  // Select Taylor expansion if tmp <= tmp_min, using that the bit pattern of a non-negative double
+  // increases with its value
+  memcpy(&tmp_bits, &tmp, sizeof(double));
+  memcpy(&tmp_min_bits, &tmp_min, sizeof(double));
+  memcpy(&w2_bits, &w2, sizeof(double));
+  memcpy(&w2_taylor_bits, &w2_taylor, sizeof(double));
+  small = -(uint64_t) (tmp_bits <= tmp_min_bits);
+  w2_bits = (w2_bits & ~small) | (w2_taylor_bits & small);
+  memcpy(&w2, &w2_bits, sizeof(double));
+  return w2;
+}
+
+/****************** END: Helper functions ****************/
 
 
 // EMA_next(X, tau)
@@ -14,18 +203,29 @@ void ema_next(const double values[], const double times[], const int *n, double
   // values_new ... array of length *n to store output time series values
   // tau        ... (positive) half-life of EMA kernel
   
-  double w;
+  double delta, delta_old = NAN, w = 0;
   
   // Trivial case
   if (*n == 0)
     return;
   
   // Calculate ema recursively
+  STATS_BEGIN();
   values_new[0] = values[0];
   for (int i = 1; i < *n; i++) {
-    w = exp(-(times[i] - times[i-1]) / *tau);
+    // Reuse the weight of the previous step if the time difference is the same, which gives exactly the same
+    // result as calculating it again
+    // -) the comparison is exact, so this only helps if the differences of consecutive observation times are
+    //    exactly equal, e.g. for integer times or times that are multiples of a power of two. For other
+    //    regularly spaced times, e.g. multiples of 0.1, the differences vary in the last bits due to rounding.
+    delta = times[i] - times[i-1];
+    if (delta != delta_old) {
+      w = exp(-delta / *tau);
+      delta_old = delta;
+    }
     values_new[i] = values_new[i-1] * w + values[i] * (1-w);
   }
+  STATS_END();
 }
 
 
@@ -38,19 +238,25 @@ void ema_last(const double values[], const double times[], const int *n, double
   // values_new ... array of length *n to store output time series values
   // tau        ... (positive) half-life of EMA kernel
   
-  double w;
+  double delta, delta_old = NAN, w = 0;
   
   // Trivial case
   if (*n == 0)
     return;
   
   // Calculate ema recursively   
+  STATS_BEGIN();
   values_new[0] = values[0];
   for (int i = 1; i < *n; i++) {
-    w = exp(-(times[i] - times[i-1]) / *tau);
+    // Reuse the weight of the previous step if the time difference is the same, see ema_next()
+    delta = times[i] - times[i-1];
+    if (delta != delta_old) {
+      w = exp(-delta / *tau);
+      delta_old = delta;
+    }
     values_new[i] = values_new[i-1] * w + values[i-1] * (1-w);
   }
-  
+  STATS_END();
 }
 
 
@@ -63,23 +269,683 @@ void ema_linear(const double values[], const double times[], const int *n, doubl
   // values_new ... array of length *n to store output time series values
   // tau        ... (positive) half-life of EMA kernel
   
-  double w, w2, tmp;
+  double delta, delta_old = NAN, w = 0, w2 = 0;
   
   // Trivial case
   if (*n == 0)
     return;
   
   // Calculate ema recursively   
+  STATS_BEGIN();
   values_new[0] = values[0];   
   for (int i = 1; i < *n; i++) {
-    tmp = (times[i] - times[i-1]) / *tau;
-    w = exp(-tmp);
-    if (tmp > 1e-6)
-      w2 = (1 - w) / tmp;
-    else {
-      // Use Taylor expansion for numerical stability
-      w2 = 1 - tmp/2 + tmp*tmp/6 - tmp*tmp*tmp/24;
+    // Reuse the weights of the previous step if the time difference is the same, see ema_next()
+    delta = times[i] - times[i-1];
+    if (delta != delta_old) {
+      ema_linear_weights(delta, *tau, &w, &w2);
+      delta_old = delta;
     }
     values_new[i] = values_new[i-1] * w + values[i] * (1 - w2) + values[i-1] * (w2 - w);
   }
+  STATS_END();
+}
+
+
+
+// EMA_next(X, tau) for several half-lives in a single pass
+// -) equivalent to calling ema_next() once for each half-life, except for a relative difference of a few ulp due to
+//    the use of exp_nonpositive() instead of exp()
+// -) the loop over the half-lives has no branches or library calls, so that the compiler can vectorize it
+void ema_next_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double taus[], const int *num_taus)
+{
+  // values     ... array of time series values
+  // times      ... array of observation times
+  // n          ... number of observations, i.e. length of 'values' and 'times'
+  // values_new ... array of length (*n) * (*num_taus) to store output in column-major order, i.e. the EMA for
+  //                the k-th half-life at time t_i is stored in values_new[i + k * (*n)]
+  // taus       ... array of (positive) half-lives of EMA kernel
+  // num_taus   ... number of half-lives, i.e. length of 'taus'
+  
+  int num = *num_taus;
+  double delta, value, w;
+  
+  // Trivial case
+  if ((*n == 0) || (num == 0))
+    return;
+  
+  // EMA value and inverse half-life for each half-life
+  double *ema = malloc(2 * num * sizeof(double)), *tau_inv = ema + num;
+  if (ema == NULL) {
+    // Out of memory -> calculate one half-life at a time, which needs no workspace
+    for (int k = 0; k < num; k++)
+      ema_next(values, times, n, values_new + k * (*n), &taus[k]);
+    return;
+  }
+  for (int k = 0; k < num; k++) {
+    tau_inv[k] = 1 / taus[k];
+    ema[k] = values[0];
+    values_new[k * (*n)] = values[0];
+  }
+  
+  // Calculate emas recursively
+  for (int i = 1; i < *n; i++) {
+    delta = times[i] - times[i-1];
+    value = values[i];
+    for (int k = 0; k < num; k++) {
+      w = exp_nonpositive(-delta * tau_inv[k]);
+      ema[k] = ema[k] * w + value * (1-w);
+    }
+    for (int k = 0; k < num; k++)
+      values_new[i + k * (*n)] = ema[k];
+  }
+  free(ema);
+}
+
+
+// EMA_last(X, tau) for several half-lives in a single pass
+// -) equivalent to calling ema_last() once for each half-life, except for a relative difference of a few ulp due to
+//    the use of exp_nonpositive() instead of exp()
+// -) the loop over the half-lives has no branches or library calls, so that the compiler can vectorize it
+void ema_last_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double taus[], const int *num_taus)
+{
+  // values     ... array of time series values
+  // times      ... array of observation times
+  // n          ... number of observations, i.e. length of 'values' and 'times'
+  // values_new ... array of length (*n) * (*num_taus) to store output in column-major order, i.e. the EMA for
+  //                the k-th half-life at time t_i is stored in values_new[i + k * (*n)]
+  // taus       ... array of (positive) half-lives of EMA kernel
+  // num_taus   ... number of half-lives, i.e. length of 'taus'
+  
+  int num = *num_taus;
+  double delta, value_old, w;
+  
+  // Trivial case
+  if ((*n == 0) || (num == 0))
+    return;
+  
+  // EMA value and inverse half-life for each half-life
+  double *ema = malloc(2 * num * sizeof(double)), *tau_inv = ema + num;
+  if (ema == NULL) {
+    // Out of memory -> calculate one half-life at a time, which needs no workspace
+    for (int k = 0; k < num; k++)
+      ema_last(values, times, n, values_new + k * (*n), &taus[k]);
+    return;
+  }
+  for (int k = 0; k < num; k++) {
+    tau_inv[k] = 1 / taus[k];
+    ema[k] = values[0];
+    values_new[k * (*n)] = values[0];
+  }
+  
+  // Calculate emas recursively
+  for (int i = 1; i < *n; i++) {
+    delta = times[i] - times[i-1];
+    value_old = values[i-1];
+    for (int k = 0; k < num; k++) {
+      w = exp_nonpositive(-delta * tau_inv[k]);
+      ema[k] = ema[k] * w + value_old * (1-w);
+    }
+    for (int k = 0; k < num; k++)
+      values_new[i + k * (*n)] = ema[k];
+  }
+  free(ema);
+}
+
+
+// EMA_linear(X, tau) for several half-lives in a single pass
+// -) equivalent to calling ema_linear() once for each half-life, except for a relative difference of a few ulp due to
+//    the use of exp_nonpositive() instead of exp()
+// -) the loop over the half-lives has no branches or library calls, so that the compiler can vectorize it
+void ema_linear_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double taus[], const int *num_taus)
+{
+  // values     ... array of time series values
+  // times      ... array of observation times
+  // n          ... number of observations, i.e. length of 'values' and 'times'
+  // values_new ... array of length (*n) * (*num_taus) to store output in column-major order, i.e. the EMA for
+  //                the k-th half-life at time t_i is stored in values_new[i + k * (*n)]
+  // taus       ... array of (positive) half-lives of EMA kernel
+  // num_taus   ... number of half-lives, i.e. length of 'taus'
+  
+  int num = *num_taus;
+  double delta, value, value_old, w, w2, tmp;
+  
+  // Trivial case
+  if ((*n == 0) || (num == 0))
+    return;
+  
+  // EMA value and inverse half-life for each half-life
+  double *ema = malloc(2 * num * sizeof(double)), *tau_inv = ema + num;
+  if (ema == NULL) {
+    // Out of memory -> calculate one half-life at a time, which needs no workspace
+    for (int k = 0; k < num; k++)
+      ema_linear(values, times, n, values_new + k * (*n), &taus[k]);
+    return;
+  }
+  for (int k = 0; k < num; k++) {
+    tau_inv[k] = 1 / taus[k];
+    ema[k] = values[0];
+    values_new[k * (*n)] = values[0];
+  }
+  
+  // Calculate emas recursively
+  for (int i = 1; i < *n; i++) {
+    delta = times[i] - times[i-1];
+    value = values[i];
+    value_old = values[i-1];
+    for (int k = 0; k < num; k++) {
+      tmp = delta * tau_inv[k];
+      w = exp_nonpositive(-tmp);
+      
+      w2 = ema_linear_weight_nonbranching(tmp, 1 - w);
+      ema[k] = ema[k] * w + value * (1 - w2) + value_old * (w2 - w);
+    }
+    for (int k = 0; k < num; k++)
+      values_new[i + k * (*n)] = ema[k];
+  }
+  free(ema);
+}
+
+
+// Interpolation schemes, see ema_parallel() and ema_at()
+enum {EMA_NEXT, EMA_LAST, EMA_LINEAR};
+
+
+/*
+Calculate an EMA using several threads via a blocked parallel scan
+-) each EMA step values_new[i] = w_i * values_new[i-1] + b_i is an affine map, so the time series can be split
+   into blocks that are processed in three passes:
+   1.) in parallel, calculate the EMA of each block as if the EMA value before the block were zero
+   2.) sequentially, propagate the true EMA value at the end of each block ("carry") to the next block
+   3.) in parallel, add the contribution of the carry, i.e. the product of the weights w_i times the carry,
+       where the product of the weights equals exp(-(t_i - t_start) / tau). This pass stops early once the
+       product underflows to zero, which happens after about 708 half-lives.
+-) requires compilation with OpenMP support (e.g. -fopenmp), otherwise the calculation is sequential
+-) the result differs from the sequential calculation, because floating-point operations are carried out
+   in a different order. The absolute difference is typically a few ulp of the largest absolute value in
+   'values', but grows to about 50 ulp if the half-life is much longer than the time span of a block,
+   mostly due to the rounding error that the sequential calculation accumulates in the product of weights.
+*/
+static void ema_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *num_threads, int scheme)
+{
+  // scheme ... interpolation scheme, one of EMA_NEXT, EMA_LAST, EMA_LINEAR
+  
+  int num_blocks = *num_threads;
+  double *carry = NULL;
+  
+  // Use sequential calculation for short time series, where the overhead is not worth it, and if out of memory
+#ifdef _OPENMP
+  if ((num_blocks >= 2) && (*n >= 10000 * num_blocks))
+    carry = malloc(num_blocks * sizeof(double));
+#endif
+  if (carry == NULL) {
+    if (scheme == EMA_NEXT)
+      ema_next(values, times, n, values_new, tau);
+    else if (scheme == EMA_LAST)
+      ema_last(values, times, n, values_new, tau);
+    else
+      ema_linear(values, times, n, values_new, tau);
+    return;
+  }
+  
+#ifdef _OPENMP
+  #pragma omp parallel num_threads(num_blocks)
+#endif
+  {
+    // Pass 1: EMA of each block, starting from zero (except for the first block)
+#ifdef _OPENMP
+    #pragma omp for schedule(static, 1)
+#endif
+    for (int block = 0; block < num_blocks; block++) {
+      int start = (int) ((long long) *n * block / num_blocks), end = (int) ((long long) *n * (block + 1) / num_blocks);
+      double ema_old = 0, delta;
+      if (block == 0) {
+        values_new[0] = ema_old = values[0];
+        start = 1;
+      }
+      for (int i = start; i < end; i++) {
+        delta = times[i] - times[i-1];
+        if (scheme == EMA_NEXT)
+          ema_old = ema_next_step(ema_old, values[i-1], values[i], delta, *tau);
+        else if (scheme == EMA_LAST)
+          ema_old = ema_last_step(ema_old, values[i-1], values[i], delta, *tau);
+        else
+          ema_old = ema_linear_step(ema_old, values[i-1], values[i], delta, *tau);
+        values_new[i] = ema_old;
+      }
+    }
+    
+    // Pass 2: propagate the true EMA value at the end of each block
+#ifdef _OPENMP
+    #pragma omp single
+#endif
+    {
+      carry[0] = values_new[*n / num_blocks - 1];
+      for (int block = 1; block < num_blocks; block++) {
+        int start = (int) ((long long) *n * block / num_blocks), end = (int) ((long long) *n * (block + 1) / num_blocks);
+        carry[block] = values_new[end - 1] + exp(-(times[end - 1] - times[start - 1]) / *tau) * carry[block - 1];
+      }
+    }
+    
+    // Pass 3: add contribution of carry from previous block
+    // -) the weights are calculated with the vectorizable exp_nonpositive() in groups of 256 observations,
+    //    which makes this pass much cheaper than the first one
+#ifdef _OPENMP
+    #pragma omp for schedule(static, 1)
+#endif
+    for (int block = 1; block < num_blocks; block++) {
+      int start = (int) ((long long) *n * block / num_blocks), end = (int) ((long long) *n * (block + 1) / num_blocks);
+      double t_start = times[start - 1], tau_inv = 1 / *tau, carry_old = carry[block - 1], w = 1;
+      for (int group = start; (group < end) && (w > 0); group += 256) {
+        int group_end = (group + 256 < end) ? group + 256 : end;
+        for (int i = group; i < group_end; i++) {
+          w = exp_nonpositive(-(times[i] - t_start) * tau_inv);
+          values_new[i] += w * carry_old;
+        }
+      }
+    }
+  }
+  free(carry);
+}
+
+
+// Same as ema_next(), but use several threads (see ema_parallel)
+void ema_next_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *num_threads)
+{
+  // values      ... array of time series values
+  // times       ... array of observation times
+  // n           ... number of observations, i.e. length of 'values' and 'times'
+  // values_new  ... array of length *n to store output time series values
+  // tau         ... (positive) half-life of EMA kernel
+  // num_threads ... number of threads to use
+  
+  ema_parallel(values, times, n, values_new, tau, num_threads, EMA_NEXT);
 }
+
+
+// Same as ema_last(), but use several threads (see ema_parallel)
+void ema_last_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *num_threads)
+{
+  // values      ... array of time series values
+  // times       ... array of observation times
+  // n           ... number of observations, i.e. length of 'values' and 'times'
+  // values_new  ... array of length *n to store output time series values
+  // tau         ... (positive) half-life of EMA kernel
+  // num_threads ... number of threads to use
+  
+  ema_parallel(values, times, n, values_new, tau, num_threads, EMA_LAST);
+}
+
+
+// Same as ema_linear(), but use several threads (see ema_parallel)
+void ema_linear_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *num_threads)
+{
+  // values      ... array of time series values
+  // times       ... array of observation times
+  // n           ... number of observations, i.e. length of 'values' and 'times'
+  // values_new  ... array of length *n to store output time series values
+  // tau         ... (positive) half-life of EMA kernel
+  // num_threads ... number of threads to use
+  
+  ema_parallel(values, times, n, values_new, tau, num_threads, EMA_LINEAR);
+}
+
+
+/*
+Calculate an EMA only at the output times 'times_out', which need not coincide with the observation times
+-) the EMA is updated at each observation time as usual, because every observation contributes to the EMA
+   at later times, but only the output values are stored
+-) between observations, the EMA is extrapolated from the most recent observation time to the output time,
+   using the value of the interpolated time series at the output time, e.g. for EMA_next the next observation
+   value, and for EMA_linear the linearly interpolated value (the last observation value after the last observation)
+-) the result at an observation time is the same as the one of the corresponding array-based function (at the
+   last observation for identical observation times), and NAN before the first observation time
+*/
+static void ema_at(const double values[], const double times[], int n, const double times_out[], int n_out,
+  double values_new[], double tau, int scheme)
+{
+  int j = 0;   // number of observations not after the current output time
+  double ema = NAN;
+  
+  for (int k = 0; k < n_out; k++) {
+    // Update EMA up to most recent observation
+    while ((j < n) && (times[j] <= times_out[k])) {
+      if (j == 0)
+        ema = values[0];
+      else if (scheme == EMA_NEXT)
+        ema = ema_next_step(ema, values[j-1], values[j], times[j] - times[j-1], tau);
+      else if (scheme == EMA_LAST)
+        ema = ema_last_step(ema, values[j-1], values[j], times[j] - times[j-1], tau);
+      else
+        ema = ema_linear_step(ema, values[j-1], values[j], times[j] - times[j-1], tau);
+      j++;
+    }
+    
+    // Extrapolate EMA to output time
+    if (j == 0)
+      values_new[k] = NAN;
+    else {
+      double delta = times_out[k] - times[j-1], value = values[j-1];
+      if (scheme == EMA_NEXT) {
+        value = (j < n) ? values[j] : value;
+        values_new[k] = ema_next_step(ema, values[j-1], value, delta, tau);
+      } else if (scheme == EMA_LAST)
+        values_new[k] = ema_last_step(ema, values[j-1], value, delta, tau);
+      else {
+        if (j < n) {
+          double w = (times[j] - times_out[k]) / (times[j] - times[j-1]);
+          value = values[j-1] * w + values[j] * (1 - w);
+        }
+        values_new[k] = ema_linear_step(ema, values[j-1], value, delta, tau);
+      }
+    }
+  }
+}
+
+
+// EMA_next(X, tau) evaluated at the times 'times_out' (see ema_at)
+void ema_next_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *tau)
+{
+  // values     ... array of time series values
+  // times      ... array of observation times
+  // n          ... number of observations, i.e. length of 'values' and 'times'
+  // times_out  ... array of output times (not decreasing)
+  // n_out      ... number of output times, i.e. length of 'times_out'
+  // values_new ... array of length *n_out to store output values
+  // tau        ... (positive) half-life of EMA kernel
+  
+  ema_at(values, times, *n, times_out, *n_out, values_new, *tau, EMA_NEXT);
+}
+
+
+// EMA_last(X, tau) evaluated at the times 'times_out' (see ema_at)
+void ema_last_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *tau)
+{
+  // all arguments are the same as for ema_next_at()
+  
+  ema_at(values, times, *n, times_out, *n_out, values_new, *tau, EMA_LAST);
+}
+
+
+// EMA_linear(X, tau) evaluated at the times 'times_out' (see ema_at)
+void ema_linear_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *tau)
+{
+  // all arguments are the same as for ema_next_at()
+  
+  ema_at(values, times, *n, times_out, *n_out, values_new, *tau, EMA_LINEAR);
+}
+
+
+/******************* Accuracy modes ********************/
+
+// Number of observations per block of the weight calculation in ema_approx()
+#define EMA_APPROX_BLOCK 256
+
+
+/*
+Same as 1 - w2 in ema_linear_step() with w = 1 + q, where q = exp(-tmp) - 1 is approximated by
+expm1_nonpositive(-tmp, degree), but with a small relative error also for tmp close to zero, where 1 - w2 is
+about tmp / 2
+-) evaluates both 1 + q / tmp and the Taylor series of 1 - (1 - exp(-tmp)) / tmp, and selects the latter for
+   tmp <= 0.5 via bit operations, so that loops calling this function can be vectorized (see exp_nonpositive)
+-) the Taylor series has 'degree' + 2 terms, which gives a relative error of at most 2 * 0.5^(degree + 1) /
+   (degree + 4)!, i.e. much smaller than the relative error of expm1_nonpositive() for the same degree
+*/
+static inline double ema_linear_weight_approx(double tmp, double q, int degree)
+{
+  static const double inv_factorial[] = {1, 1, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+    1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600, 1.0 / 6227020800,
+    1.0 / 87178291200, 1.0 / 1307674368000};
+  const double tmp_max = 0.5;
+  double c, c_taylor;
+  uint64_t tmp_bits, tmp_max_bits, c_bits, c_taylor_bits, small;
+  
+  c = 1 + q / tmp;
+  c_taylor = inv_factorial[degree + 3];
+  for (int j = degree + 2; j >= 2; j--)
+    c_taylor = inv_factorial[j] - tmp * c_taylor;
+  c_taylor = tmp * c_taylor;
+  
+  // Select Taylor series if tmp <= tmp_max (see ema_linear_weight_nonbranching)
+  memcpy(&tmp_bits, &tmp, sizeof(double));
+  memcpy(&tmp_max_bits, &tmp_max, sizeof(double));
+  memcpy(&c_bits, &c, sizeof(double));
+  memcpy(&c_taylor_bits, &c_taylor, sizeof(double));
+  small = -(uint64_t) (tmp_bits <= tmp_max_bits);
+  c_bits = (c_bits & ~small) | (c_taylor_bits & small);
+  memcpy(&c, &c_bits, sizeof(double));
+  return c;
+}
+
+
+/*
+Calculate an EMA with approximate weights
+-) the weights are calculated from q_i = exp(-(t_i - t_{i-1}) / tau) - 1 via expm1_nonpositive(), in a separate
+   pass over blocks of observation times that has no branches or library calls, so that the compiler can
+   vectorize it (e.g. with -O3 -mavx2). Only the recursion itself, which has a single multiplication and
+   addition per observation, is sequential.
+-) the recursion is written in terms of q_i, e.g. values_new[i] = values_new[i-1] - q_i * (values[i] -
+   values_new[i-1]) for EMA_next, so that the relative error of 1 - w_i (and not only of w_i) is small, also
+   for time differences that are much smaller than the half-life
+-) if the weights have a relative error of at most 'eps', the EMA values differ from the exact ones by at most
+   eps times the range (i.e. maximum minus minimum) of 'values' for EMA_next and EMA_last, and by at most
+   2 * eps times the range for EMA_linear (plus the usual rounding errors)
+-) for EMA_linear with time differences much smaller than the half-life, the result is in fact more accurate
+   than that of ema_linear(), which loses digits when calculating 1 - w2 = 1 - (1 - w) / tmp
+*/
+static void ema_approx(const double values[], const double times[], int n, double values_new[], double tau,
+  int accuracy, int scheme)
+{
+  // accuracy ... EMA_APPROX_1E12 or EMA_APPROX_1E7
+  // scheme   ... interpolation scheme, one of EMA_NEXT, EMA_LAST, EMA_LINEAR
+  
+  int degree = (accuracy == EMA_APPROX_1E12) ? 10 : 7;   // see expm1_nonpositive()
+  double tau_inv = 1 / tau, q[EMA_APPROX_BLOCK], c[EMA_APPROX_BLOCK];
+  
+  // Trivial case
+  if (n == 0)
+    return;
+  
+  values_new[0] = values[0];
+  for (int start = 1; start < n; start += EMA_APPROX_BLOCK) {
+    int end = (n - start > EMA_APPROX_BLOCK) ? start + EMA_APPROX_BLOCK : n;
+    
+    // Weights for the current block of observations, with a constant degree in each loop, so that the
+    // polynomials are unrolled
+    if (degree == 10) {
+      for (int i = start; i < end; i++)
+        q[i - start] = expm1_nonpositive(-(times[i] - times[i-1]) * tau_inv, 10);
+    } else {
+      for (int i = start; i < end; i++)
+        q[i - start] = expm1_nonpositive(-(times[i] - times[i-1]) * tau_inv, 7);
+    }
+    if ((scheme == EMA_LINEAR) && (degree == 10)) {
+      for (int i = start; i < end; i++)
+        c[i - start] = ema_linear_weight_approx((times[i] - times[i-1]) * tau_inv, q[i - start], 10);
+    } else if (scheme == EMA_LINEAR) {
+      for (int i = start; i < end; i++)
+        c[i - start] = ema_linear_weight_approx((times[i] - times[i-1]) * tau_inv, q[i - start], 7);
+    }
+    
+    // Calculate ema recursively
+    // -) for EMA_linear, c_i = 1 - w2_i (see ema_linear_step)
+    if (scheme == EMA_NEXT) {
+      for (int i = start; i < end; i++)
+        values_new[i] = values_new[i-1] - q[i - start] * (values[i] - values_new[i-1]);
+    } else if (scheme == EMA_LAST) {
+      for (int i = start; i < end; i++)
+        values_new[i] = values_new[i-1] - q[i - start] * (values[i-1] - values_new[i-1]);
+    } else {
+      for (int i = start; i < end; i++)
+        values_new[i] = values_new[i-1] - q[i - start] * (values[i-1] - values_new[i-1]) +
+          c[i - start] * (values[i] - values[i-1]);
+    }
+  }
+}
+
+
+// EMA with selectable accuracy, see ema_next_accuracy()
+static void ema_accuracy(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *accuracy, int scheme)
+{
+  if ((*accuracy == EMA_APPROX_1E12) || (*accuracy == EMA_APPROX_1E7))
+    ema_approx(values, times, *n, values_new, *tau, *accuracy, scheme);
+  else if (scheme == EMA_NEXT)
+    ema_next(values, times, n, values_new, tau);
+  else if (scheme == EMA_LAST)
+    ema_last(values, times, n, values_new, tau);
+  else
+    ema_linear(values, times, n, values_new, tau);
+}
+
+
+// EMA_next(X, tau) with selectable accuracy
+// -) EMA_EXACT gives the same result as ema_next()
+// -) EMA_APPROX_1E12 and EMA_APPROX_1E7 calculate the weights exp(-delta / tau) - 1 with a relative error of at
+//    most 1e-12 and 1e-7, respectively (see ema_approx for the resulting error of the EMA values)
+void ema_next_accuracy(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *accuracy)
+{
+  // values     ... array of time series values
+  // times      ... array of observation times
+  // n          ... number of observations, i.e. length of 'values' and 'times'
+  // values_new ... array of length *n to store output time series values
+  // tau        ... (positive) half-life of EMA kernel
+  // accuracy   ... one of EMA_EXACT, EMA_APPROX_1E12, EMA_APPROX_1E7
+  
+  ema_accuracy(values, times, n, values_new, tau, accuracy, EMA_NEXT);
+}
+
+
+// EMA_last(X, tau) with selectable accuracy, see ema_next_accuracy()
+void ema_last_accuracy(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *accuracy)
+{
+  // all arguments are the same as for ema_next_accuracy()
+  
+  ema_accuracy(values, times, n, values_new, tau, accuracy, EMA_LAST);
+}
+
+
+// EMA_linear(X, tau) with selectable accuracy, see ema_next_accuracy()
+void ema_linear_accuracy(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *accuracy)
+{
+  // all arguments are the same as for ema_next_accuracy()
+  
+  ema_accuracy(values, times, n, values_new, tau, accuracy, EMA_LINEAR);
+}
+
+/****************** END: Accuracy modes ****************/
+
+
+/******************* Streaming interface ********************/
+
+// Initialize the state of an EMA that is updated one observation at a time
+static inline void ema_init(ema_state *state, const double *tau)
+{
+  // state ... EMA state to initialize
+  // tau   ... (positive) half-life of EMA kernel
+  
+  state->tau = *tau;
+  state->time = NAN;
+  state->value = NAN;
+  state->ema = NAN;
+  state->initialized = 0;
+}
+
+
+// Initialize the state of an EMA_next(X, tau)
+void ema_next_init(ema_state *state, const double *tau)
+{
+  ema_init(state, tau);
+}
+
+
+// Initialize the state of an EMA_last(X, tau)
+void ema_last_init(ema_state *state, const double *tau)
+{
+  ema_init(state, tau);
+}
+
+
+// Initialize the state of an EMA_linear(X, tau)
+void ema_linear_init(ema_state *state, const double *tau)
+{
+  ema_init(state, tau);
+}
+
+
+// Add an observation to an EMA_next(X, tau) and return the updated EMA value
+double ema_next_update(ema_state *state, const double *time, const double *value)
+{
+  // state ... EMA state initialized via ema_next_init()
+  // time  ... observation time (not smaller than time of previous observation)
+  // value ... observation value
+  
+  if (state->initialized)
+    state->ema = ema_next_step(state->ema, state->value, *value, *time - state->time, state->tau);
+  else {
+    state->ema = *value;
+    state->initialized = 1;
+  }
+  state->time = *time;
+  state->value = *value;
+  return state->ema;
+}
+
+
+// Add an observation to an EMA_last(X, tau) and return the updated EMA value
+double ema_last_update(ema_state *state, const double *time, const double *value)
+{
+  // state ... EMA state initialized via ema_last_init()
+  // time  ... observation time (not smaller than time of previous observation)
+  // value ... observation value
+  
+  if (state->initialized)
+    state->ema = ema_last_step(state->ema, state->value, *value, *time - state->time, state->tau);
+  else {
+    state->ema = *value;
+    state->initialized = 1;
+  }
+  state->time = *time;
+  state->value = *value;
+  return state->ema;
+}
+
+
+// Add an observation to an EMA_linear(X, tau) and return the updated EMA value
+double ema_linear_update(ema_state *state, const double *time, const double *value)
+{
+  // state ... EMA state initialized via ema_linear_init()
+  // time  ... observation time (not smaller than time of previous observation)
+  // value ... observation value
+  
+  if (state->initialized)
+    state->ema = ema_linear_step(state->ema, state->value, *value, *time - state->time, state->tau);
+  else {
+    state->ema = *value;
+    state->initialized = 1;
+  }
+  state->time = *time;
+  state->value = *value;
+  return state->ema;
+}
+
+
+// Current EMA value (NAN if no observation has been processed yet)
+double ema_value(const ema_state *state)
+{
+  return state->ema;
+}
+
+/****************** END: Streaming interface ****************/
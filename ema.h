@@ -9,4 +9,63 @@ void ema_next(const double values[], const double times[], const int *n, double
 void ema_last(const double values[], const double times[], const int *n, double values_new[], const double *tau);
 void ema_linear(const double values[], const double times[], const int *n, double values_new[], const double *tau);
 
+void ema_next_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double taus[], const int *num_taus);
+void ema_last_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double taus[], const int *num_taus);
+void ema_linear_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double taus[], const int *num_taus);
+
+void ema_next_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *num_threads);
+void ema_last_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *num_threads);
+void ema_linear_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *num_threads);
+
+void ema_next_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *tau);
+void ema_last_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *tau);
+void ema_linear_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *tau);
+
+
+// Same as ema_next(), ema_last() and ema_linear(), but with selectable accuracy of the EMA weights
+// -) EMA_EXACT uses exp() from the C library, while EMA_APPROX_1E12 and EMA_APPROX_1E7 use a faster, vectorizable
+//    approximation with a relative error of at most 1e-12 and 1e-7, respectively (see ema_approx() in ema.c)
+enum {EMA_EXACT, EMA_APPROX_1E12, EMA_APPROX_1E7};
+
+void ema_next_accuracy(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *accuracy);
+void ema_last_accuracy(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *accuracy);
+void ema_linear_accuracy(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau, const int *accuracy);
+
+
+/*
+Streaming interface: update an EMA one observation at a time
+-) each update is O(1) and does not allocate memory
+-) produces exactly the same values as the corresponding array-based function above
+-) the struct members are private and should only be accessed via the functions below
+*/
+typedef struct {
+  double tau;        // (positive) half-life of EMA kernel
+  double time;       // time of most recent observation
+  double value;      // value of most recent observation
+  double ema;        // EMA value at time 'time'
+  int initialized;   // has at least one observation been processed?
+} ema_state;
+
+void ema_next_init(ema_state *state, const double *tau);
+void ema_last_init(ema_state *state, const double *tau);
+void ema_linear_init(ema_state *state, const double *tau);
+
+double ema_next_update(ema_state *state, const double *time, const double *value);
+double ema_last_update(ema_state *state, const double *time, const double *value);
+double ema_linear_update(ema_state *state, const double *time, const double *value);
+
+double ema_value(const ema_state *state);
+
 #endif
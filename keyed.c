@@ -0,0 +1,253 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "ema.h"
+#include "keyed.h"
+#include "rolling.h"
+
+
+/******************* Helper functions ********************/
+
+// Hash table with open addressing (and linear probing), which maps each key to a consecutive index 0, 1, 2, ...
+typedef struct {
+  int *keys;       // key in each slot
+  int *indices;    // index of key in each slot, or -1 for an empty slot
+  int bits;        // base-2 logarithm of number of slots (zero before the first insertion)
+  int count;       // number of keys
+} key_table;
+
+
+static inline void key_table_init(key_table *table)
+{
+  table->keys = table->indices = NULL;
+  table->bits = table->count = 0;
+}
+
+
+static inline void key_table_free(key_table *table)
+{
+  free(table->keys);
+  free(table->indices);
+  key_table_init(table);
+}
+
+
+// Slot at which to start searching for a key (Fibonacci hashing)
+static inline int key_table_slot(const key_table *table, int key)
+{
+  return (int) (((uint32_t) key * UINT32_C(2654435769)) >> (32 - table->bits));
+}
+
+
+// Double the number of slots of a hash table (returns 0 on success, -1 if out of memory)
+static int key_table_grow(key_table *table)
+{
+  int bits_new = (table->bits > 0) ? table->bits + 1 : 4;
+  int capacity = (table->bits > 0) ? (1 << table->bits) : 0, capacity_new = 1 << bits_new;
+  int *keys_new = malloc(capacity_new * sizeof(int));
+  int *indices_new = malloc(capacity_new * sizeof(int));
+  if ((keys_new == NULL) || (indices_new == NULL)) {
+    free(keys_new);
+    free(indices_new);
+    return -1;
+  }
+  
+  // Re-insert keys into new slots
+  key_table table_new = {keys_new, indices_new, bits_new, table->count};
+  for (int slot = 0; slot < capacity_new; slot++)
+    indices_new[slot] = -1;
+  for (int slot = 0; slot < capacity; slot++) {
+    if (table->indices[slot] < 0)
+      continue;
+    int slot_new = key_table_slot(&table_new, table->keys[slot]);
+    while (indices_new[slot_new] >= 0)
+      slot_new = (slot_new + 1) & (capacity_new - 1);
+    keys_new[slot_new] = table->keys[slot];
+    indices_new[slot_new] = table->indices[slot];
+  }
+  
+  free(table->keys);
+  free(table->indices);
+  *table = table_new;
+  return 0;
+}
+
+
+// Return the index of a key, which is added to the table if not present yet (-1 if out of memory)
+static inline int key_table_index(key_table *table, int key)
+{
+  // Keep load factor at most 1/2, so that the expected number of probes is small
+  if (2 * (table->count + 1) > (1 << table->bits)) {
+    if (key_table_grow(table) != 0)
+      return -1;
+  }
+  
+  int mask = (1 << table->bits) - 1;
+  int slot = key_table_slot(table, key);
+  while (table->indices[slot] >= 0) {
+    if (table->keys[slot] == key)
+      return table->indices[slot];
+    slot = (slot + 1) & mask;
+  }
+  table->keys[slot] = key;
+  table->indices[slot] = table->count;
+  return table->count++;
+}
+
+
+// Increase the capacity of an array to at least 'capacity_min' elements
+// -) returns the (possibly moved) array, or NULL if out of memory, in which case the array is left unchanged
+static void *array_reserve(void *array, int *capacity, int capacity_min, size_t element_size)
+{
+  if (*capacity >= capacity_min)
+    return array;
+  int capacity_new = (*capacity > 0) ? 2 * (*capacity) : 16;
+  void *array_new = realloc(array, capacity_new * element_size);
+  if (array_new != NULL)
+    *capacity = capacity_new;
+  return array_new;
+}
+
+/****************** END: Helper functions ****************/
+
+
+/******************* EMAs ********************/
+
+typedef void (*ema_init_function)(ema_state *state, const double *tau);
+typedef double (*ema_update_function)(ema_state *state, const double *time, const double *value);
+
+
+// Apply a streaming EMA separately to the observations of each key
+static void ema_keyed(ema_init_function init, ema_update_function update, const int keys[], const double values[],
+  const double times[], int n, double values_new[], const double *tau)
+{
+  key_table table;
+  ema_state *states = NULL;
+  int num_states = 0, capacity = 0;
+  
+  key_table_init(&table);
+  for (int i = 0; i < n; i++) {
+    // Find EMA state of key, and create it if necessary
+    void *states_new = array_reserve(states, &capacity, num_states + 1, sizeof(ema_state));
+    if (states_new == NULL) {
+      values_new[i] = NAN;
+      continue;
+    }
+    states = states_new;
+    int index = key_table_index(&table, keys[i]);
+    if (index < 0) {
+      values_new[i] = NAN;
+      continue;
+    }
+    if (index == num_states)
+      init(&states[num_states++], tau);
+    
+    values_new[i] = update(&states[index], &times[i], &values[i]);
+  }
+  
+  key_table_free(&table);
+  free(states);
+}
+
+
+/*
+Calculate EMA_next(X, tau) separately for the observations of each key
+-) the output is the same as when applying ema_next() to the observations of each key, without having to copy
+   the observations of each key into a separate array, or the output back into stream order
+-) the state of each key is an ema_state, and the states are found via a hash table with open addressing
+-) returns NAN for the affected observations if out of memory
+*/
+void ema_next_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const double *tau)
+{
+  // keys       ... array of keys, e.g. the number of the financial instrument of each observation
+  // values     ... array of time series values
+  // times      ... array of observation times (not decreasing for the observations of each key)
+  // n          ... number of observations, i.e. length of 'keys', 'values' and 'times'
+  // values_new ... array of length *n to store output time series values
+  // tau        ... (positive) half-life of EMA kernel
+  
+  ema_keyed(ema_next_init, ema_next_update, keys, values, times, *n, values_new, tau);
+}
+
+
+// Same as ema_next_keyed(), but for EMA_last(X, tau)
+void ema_last_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const double *tau)
+{
+  ema_keyed(ema_last_init, ema_last_update, keys, values, times, *n, values_new, tau);
+}
+
+
+// Same as ema_next_keyed(), but for EMA_linear(X, tau)
+void ema_linear_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const double *tau)
+{
+  ema_keyed(ema_linear_init, ema_linear_update, keys, values, times, *n, values_new, tau);
+}
+
+/****************** END: EMAs ****************/
+
+
+/******************* Rolling operators ********************/
+
+/*
+Calculate a rolling operator separately for the observations of each key
+-) the output is the same as when pushing the observations of each key into a rolling_stream, i.e. the time
+   window is (t_i - width_before, t_i], see rolling_stream_push() for details
+-) for tied observation times, the time window only contains the observations up to and including observation
+   i, which differs from rolling_* with width_after = 0 (see keyed.h)
+-) returns NAN for the affected observations if out of memory
+*/
+void rolling_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const int *op, const double *width_before)
+{
+  // keys         ... array of keys, e.g. the number of the financial instrument of each observation
+  // values       ... array of time series values
+  // times        ... array of observation times (not decreasing for the observations of each key)
+  // n            ... number of observations, i.e. length of 'keys', 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // op           ... which rolling operator, e.g. ROLLING_SUM
+  // width_before ... (non-negative) width of rolling window before t_i
+  
+  key_table table;
+  rolling_stream **streams = NULL;
+  int num_streams = 0, capacity = 0;
+  
+  key_table_init(&table);
+  for (int i = 0; i < *n; i++) {
+    // Find rolling operator state of key, and create it if necessary
+    void *streams_new = array_reserve(streams, &capacity, num_streams + 1, sizeof(rolling_stream *));
+    if (streams_new == NULL) {
+      values_new[i] = NAN;
+      continue;
+    }
+    streams = streams_new;
+    int index = key_table_index(&table, keys[i]);
+    if (index < 0) {
+      values_new[i] = NAN;
+      continue;
+    }
+    if (index == num_streams)
+      streams[num_streams++] = NULL;
+    if (streams[index] == NULL) {
+      streams[index] = rolling_stream_new(op, width_before);
+      if (streams[index] == NULL) {
+        values_new[i] = NAN;
+        continue;
+      }
+    }
+    
+    values_new[i] = rolling_stream_push(streams[index], &times[i], &values[i]);
+  }
+  
+  for (int j = 0; j < num_streams; j++)
+    rolling_stream_free(streams[j]);
+  key_table_free(&table);
+  free(streams);
+}
+
+/****************** END: Rolling operators ****************/
@@ -0,0 +1,28 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+// Remark: To facilitate interfaces to other programming languages such as R, all variables are either pointers or arrays
+
+#ifndef _keyed_h
+#define _keyed_h
+
+/*
+Keyed operators: apply an operator separately to each of many time series, whose observations are interleaved
+in a single stream of (key, time, value) triples sorted by time
+-) the output for each observation is stored at the same position as the observation, i.e. in stream order
+-) rolling_keyed() processes each observation when it arrives, so for tied observation times of the same key,
+   the time window of an observation does not include the later observations with the same time. The output
+   therefore differs from the one of the rolling_* operators for the observations of a single key, even for
+   width_after = 0, whose time window (t_i - width_before, t_i] includes all observations at time t_i.
+-) see ema_next_keyed() and rolling_keyed() for details
+*/
+void ema_next_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const double *tau);
+void ema_last_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const double *tau);
+void ema_linear_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const double *tau);
+
+void rolling_keyed(const int keys[], const double values[], const double times[], const int *n, double values_new[],
+  const int *op, const double *width_before);
+
+#endif
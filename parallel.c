@@ -0,0 +1,324 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parallel.h"
+
+
+/******************* Helper functions ********************/
+
+// Return the position of the first observation time that is larger than 'time' (or n if there is none)
+static inline int first_after(const double times[], int n, double time)
+{
+  int low = 0, high = n;   // loop invariant: times[low - 1] <= time < times[high]
+  
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (times[mid] <= time)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+
+// Return the position of the first observation time that is not smaller than 'time' (or n if there is none)
+static inline int first_not_before(const double times[], int n, double time)
+{
+  int low = 0, high = n;   // loop invariant: times[low - 1] < time <= times[high]
+  
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (times[mid] < time)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+
+// Calculate the output of a rolling operator for positions start, ..., end - 1 of a time series
+// -) returns 0 on success, or -1 if memory allocation fails
+static int apply_block(rolling_operator op, int interpolated, const double values[], const double times[], int n,
+  double values_new[], const double *width_before, const double *width_after, int start, int end)
+{
+  int low, high, n_block;
+  
+  // Find observations needed to calculate output for positions start, ..., end - 1
+  if (interpolated) {
+    // The sequential SMA calculation needs the observation before the window and after the window, and
+    // sets the output for the first observation to the first observation value, so that position start
+    // must not be the first observation of the block (unless start = 0)
+    low = first_not_before(times, n, times[start] - *width_before) - 1;
+    low = (low < 0) ? 0 : low;
+    high = first_after(times, n, times[end - 1] + *width_after) + 1;
+    high = (high > n) ? n : high;
+  } else {
+    low = first_after(times, n, times[start] - *width_before);
+    low = (low > start) ? start : low;   // for width_before = 0, the window might not contain t_start
+    high = first_after(times, n, times[end - 1] + *width_after);
+  }
+  
+  // Apply sequential operator to block and copy relevant output
+  n_block = high - low;
+  double *values_block = malloc(n_block * sizeof(double));
+  if (values_block == NULL)
+    return -1;
+  op(values + low, times + low, &n_block, values_block, width_before, width_after);
+  memcpy(values_new + start, values_block + (start - low), (end - start) * sizeof(double));
+  free(values_block);
+  return 0;
+}
+
+/****************** END: Helper functions ****************/
+
+
+/*
+Apply a rolling operator using several threads
+-) the output of a rolling operator at time t_i only depends on the observations in the time window
+   [t_i - width_before, t_i + width_after] (plus, for the SMAs, the neighboring observation on either side),
+   so the output can be split into blocks, which are processed independently after finding the observations
+   needed for each block via binary search
+-) each block is handed to the sequential operator, so the results are identical to the sequential calculation
+   for operators without running sums (rolling_num_obs, rolling_max, rolling_min, rolling_median). For all other
+   operators, the running sums (e.g. the areas of the SMAs, or the partial aggregates of rolling_sum) start from
+   scratch in each block instead of being carried over from the previous observations, so the results agree with
+   the sequential calculation only up to rounding errors.
+-) requires compilation with OpenMP support (e.g. -fopenmp), otherwise the calculation is sequential
+-) if the memory for a block cannot be allocated, the output of this block is NAN
+*/
+void apply_parallel(rolling_operator op, const int *interpolated, const double values[], const double times[],
+  const int *n, double values_new[], const double *width_before, const double *width_after, const int *num_threads)
+{
+  // op           ... the sequential rolling operator, e.g. rolling_sum or sma_last
+  // interpolated ... non-zero for operators that interpolate between observations (i.e. the SMAs) and
+  //                  therefore need the observations just outside the time window
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // num_threads  ... number of threads to use
+  
+  // Several blocks per thread for better load balancing, because the windows may differ in size
+  int num_blocks = 4 * (*num_threads);
+  
+  // Use sequential calculation for short time series, where the overhead is not worth it
+#ifdef _OPENMP
+  if ((*num_threads < 2) || (*n < 10000 * num_blocks))
+#endif
+  {
+    op(values, times, n, values_new, width_before, width_after);
+    return;
+  }
+  
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(*num_threads) schedule(dynamic, 1)
+#endif
+  for (int block = 0; block < num_blocks; block++) {
+    int start = (int) ((long long) *n * block / num_blocks), end = (int) ((long long) *n * (block + 1) / num_blocks);
+    if (apply_block(op, *interpolated, values, times, *n, values_new, width_before, width_after, start, end) != 0) {
+      // Out of memory
+      for (int i = start; i < end; i++)
+        values_new[i] = NAN;
+    }
+  }
+}
+
+
+/******************* Batch interface ********************/
+
+// A unit of work for rolling_batch() and ema_batch(): positions start, ..., end - 1 of one time series
+typedef struct {
+  int series;
+  int start;
+  int end;
+} work_item;
+
+
+// Sort work items by decreasing length, and by time series and position for ties
+static int compare_work_items(const void *a, const void *b)
+{
+  const work_item *item1 = a, *item2 = b;
+  
+  if (item1->end - item1->start != item2->end - item2->start)
+    return (item2->end - item2->start) - (item1->end - item1->start);
+  if (item1->series != item2->series)
+    return item1->series - item2->series;
+  return item1->start - item2->start;
+}
+
+
+// Check the observations of one time series in CSR layout, and return its status
+static int check_series(const double times[], const int offsets[], int series)
+{
+  int start = offsets[series], end = offsets[series + 1];
+  
+  if ((start < 0) || (end < start))
+    return BATCH_INVALID_OFFSETS;
+  for (int i = start + 1; i < end; i++) {
+    if (!(times[i] >= times[i-1]))   // also catches NaN observation times
+      return BATCH_UNSORTED_TIMES;
+  }
+  return BATCH_OK;
+}
+
+
+/*
+Check all time series and split the valid ones into work items of at most 'block_length' observations
+-) the work items are sorted by decreasing length, so that the longest ones are started first and the short
+   ones fill the gaps at the end
+-) returns the work items (to be freed by the caller), or NULL if memory allocation fails or there is no work
+*/
+static work_item *make_work_items(const double times[], const int offsets[], int num_series, double values_new[],
+  int status[], int block_length, int num_threads, int *num_items)
+{
+  // Check input time series
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 64)
+#else
+  (void) num_threads;
+#endif
+  for (int series = 0; series < num_series; series++) {
+    status[series] = check_series(times, offsets, series);
+    if (status[series] == BATCH_UNSORTED_TIMES) {
+      for (int i = offsets[series]; i < offsets[series + 1]; i++)
+        values_new[i] = NAN;
+    }
+  }
+  
+  // Count work items
+  *num_items = 0;
+  for (int series = 0; series < num_series; series++) {
+    if (status[series] == BATCH_OK)
+      *num_items += (int) (((long long) offsets[series + 1] - offsets[series] + block_length - 1) / block_length);
+  }
+  if (*num_items == 0)
+    return NULL;
+  
+  // Create work items of (almost) equal length for each time series
+  work_item *items = malloc(*num_items * sizeof(work_item));
+  if (items == NULL) {
+    for (int series = 0; series < num_series; series++)
+      status[series] = (status[series] == BATCH_OK) ? BATCH_OUT_OF_MEMORY : status[series];
+    return NULL;
+  }
+  int pos = 0;
+  for (int series = 0; series < num_series; series++) {
+    int n = offsets[series + 1] - offsets[series];
+    if ((status[series] != BATCH_OK) || (n == 0))
+      continue;
+    int num_blocks = (int) (((long long) n + block_length - 1) / block_length);
+    for (int block = 0; block < num_blocks; block++) {
+      items[pos].series = series;
+      items[pos].start = (int) ((long long) n * block / num_blocks);
+      items[pos].end = (int) ((long long) n * (block + 1) / num_blocks);
+      pos++;
+    }
+  }
+  qsort(items, *num_items, sizeof(work_item), compare_work_items);
+  
+  return items;
+}
+
+
+/*
+Apply a rolling operator to many time series using several threads
+-) the time series are stored in CSR (compressed sparse row) layout: the observations of time series i are at
+   positions offsets[i], ..., offsets[i+1] - 1 of 'values' and 'times', and the output is stored at the same
+   positions of 'values_new'
+-) the work is distributed dynamically: each thread takes the next unprocessed work item from a shared queue
+   as soon as it is done with the previous one, and the longest work items are processed first
+-) time series that are much longer than the average amount of work per thread are split into several work items,
+   like in apply_parallel(), so that a few very long time series do not leave most threads idle (with the same
+   differences to the sequential results as described there)
+-) status[i] is set to BATCH_OK if time series i was processed successfully, BATCH_INVALID_OFFSETS if its
+   offsets are invalid (then its output is not touched), BATCH_UNSORTED_TIMES if the observation times are
+   not sorted in non-decreasing order (then its output is NaN), or BATCH_OUT_OF_MEMORY
+*/
+void rolling_batch(rolling_operator op, const double values[], const double times[], const int offsets[],
+  const int *num_series, double values_new[], const double *width_before, const double *width_after,
+  const int *num_threads, int status[])
+{
+  // op           ... a rolling operator with a two-sided time window, e.g. rolling_sd or sma_last
+  // values       ... array of concatenated time series values
+  // times        ... array of concatenated observation times
+  // offsets      ... array of length *num_series + 1 with the start position of each time series in 'values'
+  //                  and 'times', followed by the end position of the last time series
+  // num_series   ... number of time series
+  // values_new   ... array of same length as 'values' to store the output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // num_threads  ... number of threads to use
+  // status       ... array of length *num_series to store the status of each time series
+  
+  int num_items, block_length = INT_MAX, threads = (*num_threads > 1) ? *num_threads : 1;
+  
+  // Split long time series only if several threads are used, because the blocks are calculated with a small
+  // overhead (and rounding errors in the rolling sums that differ slightly from the sequential calculation)
+#ifdef _OPENMP
+  if ((threads >= 2) && (*num_series > 0)) {
+    long long total_length = (long long) offsets[*num_series] - offsets[0];
+    long long target_length = total_length / (4 * threads);
+    block_length = (target_length < 10000) ? 10000 : ((target_length > INT_MAX) ? INT_MAX : (int) target_length);
+  }
+#endif
+  work_item *items = make_work_items(times, offsets, *num_series, values_new, status, block_length, threads,
+    &num_items);
+  if (items == NULL)
+    return;
+  
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+#endif
+  for (int k = 0; k < num_items; k++) {
+    int offset = offsets[items[k].series], n = offsets[items[k].series + 1] - offset;
+    
+    // The block boundaries for the SMAs are used for all operators, because the additional observations outside
+    // of the time windows do not change the output of the rolling_* operators
+    if ((items[k].start == 0) && (items[k].end == n))
+      op(values + offset, times + offset, &n, values_new + offset, width_before, width_after);
+    else if (apply_block(op, 1, values + offset, times + offset, n, values_new + offset, width_before, width_after,
+        items[k].start, items[k].end) != 0) {
+#ifdef _OPENMP
+      #pragma omp atomic write
+#endif
+      status[items[k].series] = BATCH_OUT_OF_MEMORY;
+    }
+  }
+  free(items);
+}
+
+
+/*
+Apply an EMA to many time series using several threads
+-) same as rolling_batch(), except that each time series is processed as a single work item
+*/
+void ema_batch(ema_operator op, const double values[], const double times[], const int offsets[],
+  const int *num_series, double values_new[], const double *tau, const int *num_threads, int status[])
+{
+  // op          ... an EMA operator, e.g. ema_linear
+  // tau         ... (positive) half-life of EMA kernel
+  // all other arguments are the same as for rolling_batch()
+  
+  int num_items, threads = (*num_threads > 1) ? *num_threads : 1;
+  work_item *items = make_work_items(times, offsets, *num_series, values_new, status, INT_MAX, threads,
+    &num_items);
+  if (items == NULL)
+    return;
+  
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+#endif
+  for (int k = 0; k < num_items; k++) {
+    int offset = offsets[items[k].series], n = offsets[items[k].series + 1] - offset;
+    op(values + offset, times + offset, &n, values_new + offset, tau);
+  }
+  free(items);
+}
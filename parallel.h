@@ -0,0 +1,37 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+// Remark: To facilitate interfaces to other programming languages such as R, all variables are either pointers or arrays
+
+#ifndef _parallel_h
+#define _parallel_h
+
+// Signature shared by the rolling_* and sma_* operators with a two-sided rolling time window
+typedef void (*rolling_operator)(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after);
+
+void apply_parallel(rolling_operator op, const int *interpolated, const double values[], const double times[],
+  const int *n, double values_new[], const double *width_before, const double *width_after, const int *num_threads);
+
+
+/*
+Batch interface: apply the same operator to many time series stored in CSR layout, using several threads
+-) see rolling_batch() for details
+*/
+typedef void (*ema_operator)(const double values[], const double times[], const int *n, double values_new[],
+  const double *tau);
+
+// Status of each time series processed by the batch interface
+enum {
+  BATCH_OK,
+  BATCH_INVALID_OFFSETS,
+  BATCH_UNSORTED_TIMES,
+  BATCH_OUT_OF_MEMORY
+};
+
+void rolling_batch(rolling_operator op, const double values[], const double times[], const int offsets[],
+  const int *num_series, double values_new[], const double *width_before, const double *width_after,
+  const int *num_threads, int status[]);
+void ema_batch(ema_operator op, const double values[], const double times[], const int offsets[],
+  const int *num_series, double values_new[], const double *tau, const int *num_threads, int status[]);
+
+#endif
@@ -1,9 +1,14 @@
 // Copyright: 2012-2018 by Andreas Eckner
 // License: GPL-2 | GPL-3
 
+#include <limits.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include "parallel.h"
 #include "rolling.h"
+#include "stats.h"
 
 #ifndef SWAP
 #  define SWAP(a,b) {temp=(a); (a)=(b); (b)=temp;}
@@ -135,375 +140,2591 @@ static inline void compensated_addition(double *sum, double addend, double *comp
 
 
 
+/*
+Growable ring buffer of (time, value) pairs
+-) used as first-in-first-out queue for the observations in a rolling time window and as double-ended
+   queue for the candidate extreme values in a window
+-) the capacity is a power of two and doubles whenever the buffer is full, so memory usage is bounded by
+   the largest number of elements held at any one time
+*/
+typedef struct {
+  double *times;
+  double *values;
+  int capacity;
+  int head;      // position of first element
+  int count;     // number of elements
+} obs_ring;
+
+
+static inline void obs_ring_init(obs_ring *ring)
+{
+  ring->times = ring->values = NULL;
+  ring->capacity = ring->head = ring->count = 0;
+}
+
+
+static inline void obs_ring_free(obs_ring *ring)
+{
+  free(ring->times);
+  free(ring->values);
+  obs_ring_init(ring);
+}
+
+
+// Double the capacity of a ring buffer (returns 0 on success, -1 if out of memory)
+static int obs_ring_grow(obs_ring *ring)
+{
+  int capacity_new = (ring->capacity > 0) ? 2 * ring->capacity : 16;
+  double *times_new = malloc(capacity_new * sizeof(double));
+  double *values_new = malloc(capacity_new * sizeof(double));
+  if ((times_new == NULL) || (values_new == NULL)) {
+    free(times_new);
+    free(values_new);
+    return -1;
+  }
+  
+  // Copy elements in queue order, so that the first element ends up at position zero
+  for (int j = 0; j < ring->count; j++) {
+    int pos = (ring->head + j) & (ring->capacity - 1);
+    times_new[j] = ring->times[pos];
+    values_new[j] = ring->values[pos];
+  }
+  free(ring->times);
+  free(ring->values);
+  ring->times = times_new;
+  ring->values = values_new;
+  ring->capacity = capacity_new;
+  ring->head = 0;
+  return 0;
+}
+
+
+// Append an element at the end (returns 0 on success, -1 if out of memory)
+static inline int obs_ring_push_back(obs_ring *ring, double time, double value)
+{
+  if ((ring->count == ring->capacity) && (obs_ring_grow(ring) != 0))
+    return -1;
+  int pos = (ring->head + ring->count) & (ring->capacity - 1);
+  ring->times[pos] = time;
+  ring->values[pos] = value;
+  ring->count++;
+  return 0;
+}
+
+
+// Position of the j-th element (counting starts at zero) in the underlying arrays
+static inline int obs_ring_pos(const obs_ring *ring, int j)
+{
+  return (ring->head + j) & (ring->capacity - 1);
+}
+
+
+static inline void obs_ring_pop_front(obs_ring *ring)
+{
+  ring->head = (ring->head + 1) & (ring->capacity - 1);
+  ring->count--;
+}
+
+
+static inline void obs_ring_pop_back(obs_ring *ring)
+{
+  ring->count--;
+}
+
+
+/*
+Order statistic tree, i.e. a binary search tree that supports insertion, deletion and finding the k-th
+smallest element in O(log N) time
+-) implemented as a treap with subtree sizes, where the priorities are generated by a xorshift
+   pseudo-random number generator, so that the expected run-time does not depend on the input values
+-) the nodes are stored in a growable array (index zero is the empty sentinel) and deleted nodes are
+   recycled via a free list, so memory usage is bounded by the largest number of elements held at any one time
+-) NANs are treated as larger than any other value
+*/
+typedef struct {
+  double value;
+  int left;
+  int right;
+  int size;
+  unsigned int priority;
+} ost_node;
+
+typedef struct {
+  ost_node *nodes;
+  int capacity;
+  int root;
+  int free_list;
+  unsigned int seed;
+} order_stat_tree;
+
+
+// Total order on doubles with NANs at the end
+static inline int ost_less(double a, double b)
+{
+  return (a < b) || ((b != b) && (a == a));
+}
+
+
+static inline int ost_equal(double a, double b)
+{
+  return (a == b) || ((a != a) && (b != b));
+}
+
+
+static inline void ost_init(order_stat_tree *tree)
+{
+  tree->nodes = NULL;
+  tree->capacity = tree->root = tree->free_list = 0;
+  tree->seed = 2463534242u;
+}
+
+
+static inline void ost_free(order_stat_tree *tree)
+{
+  free(tree->nodes);
+  ost_init(tree);
+}
+
+
+// Remove all elements, but keep the allocated memory
+static inline void ost_clear(order_stat_tree *tree)
+{
+  tree->root = tree->free_list = 0;
+}
+
+
+static inline int ost_size(const order_stat_tree *tree)
+{
+  return (tree->capacity > 0) ? tree->nodes[tree->root].size : 0;
+}
+
+
+static inline int ost_rotate_right(ost_node *nodes, int t)
+{
+  int l = nodes[t].left;
+  nodes[t].left = nodes[l].right;
+  nodes[l].right = t;
+  nodes[l].size = nodes[t].size;
+  nodes[t].size = nodes[nodes[t].left].size + nodes[nodes[t].right].size + 1;
+  return l;
+}
+
+
+static inline int ost_rotate_left(ost_node *nodes, int t)
+{
+  int r = nodes[t].right;
+  nodes[t].right = nodes[r].left;
+  nodes[r].left = t;
+  nodes[r].size = nodes[t].size;
+  nodes[t].size = nodes[nodes[t].left].size + nodes[nodes[t].right].size + 1;
+  return r;
+}
+
+
+// Insert node x into the subtree rooted at t and return the new root of the subtree
+static int ost_insert_node(ost_node *nodes, int t, int x)
+{
+  if (t == 0)
+    return x;
+  
+  nodes[t].size++;
+  if (ost_less(nodes[x].value, nodes[t].value)) {
+    nodes[t].left = ost_insert_node(nodes, nodes[t].left, x);
+    if (nodes[nodes[t].left].priority > nodes[t].priority)
+      t = ost_rotate_right(nodes, t);
+  } else {
+    nodes[t].right = ost_insert_node(nodes, nodes[t].right, x);
+    if (nodes[nodes[t].right].priority > nodes[t].priority)
+      t = ost_rotate_left(nodes, t);
+  }
+  return t;
+}
+
+
+// Remove one node with the given value (which must exist) from the subtree rooted at t
+static int ost_remove_node(order_stat_tree *tree, int t, double value)
+{
+  ost_node *nodes = tree->nodes;
+  
+  if (ost_equal(value, nodes[t].value)) {
+    // Node has at most one child -> replace node by child
+    if ((nodes[t].left == 0) || (nodes[t].right == 0)) {
+      int child = nodes[t].left + nodes[t].right;
+      nodes[t].left = tree->free_list;
+      tree->free_list = t;
+      return child;
+    }
+    
+    // Otherwise rotate the node down towards the leaves
+    if (nodes[nodes[t].left].priority > nodes[nodes[t].right].priority) {
+      t = ost_rotate_right(nodes, t);
+      nodes[t].right = ost_remove_node(tree, nodes[t].right, value);
+    } else {
+      t = ost_rotate_left(nodes, t);
+      nodes[t].left = ost_remove_node(tree, nodes[t].left, value);
+    }
+  } else if (ost_less(value, nodes[t].value))
+    nodes[t].left = ost_remove_node(tree, nodes[t].left, value);
+  else
+    nodes[t].right = ost_remove_node(tree, nodes[t].right, value);
+  
+  nodes[t].size--;
+  return t;
+}
+
+
+// Insert a value (returns 0 on success, -1 if out of memory)
+static int ost_insert(order_stat_tree *tree, double value)
+{
+  int x;
+  
+  // Take a node from the free list, or otherwise the first unused node
+  // -) if the free list is empty, the nodes 1, ..., size are exactly the nodes in the tree
+  if (tree->free_list != 0) {
+    x = tree->free_list;
+    tree->free_list = tree->nodes[x].left;
+  } else {
+    x = ost_size(tree) + 1;
+    if (x >= tree->capacity) {
+      int capacity_new = (tree->capacity > 0) ? 2 * tree->capacity : 16;
+      ost_node *nodes_new = realloc(tree->nodes, capacity_new * sizeof(ost_node));
+      if (nodes_new == NULL)
+        return -1;
+      nodes_new[0].size = nodes_new[0].left = nodes_new[0].right = 0;
+      nodes_new[0].priority = 0;
+      tree->nodes = nodes_new;
+      tree->capacity = capacity_new;
+    }
+  }
+  
+  // Pseudo-random priority via xorshift
+  tree->seed ^= tree->seed << 13;
+  tree->seed ^= tree->seed >> 17;
+  tree->seed ^= tree->seed << 5;
+  
+  tree->nodes[x].value = value;
+  tree->nodes[x].left = tree->nodes[x].right = 0;
+  tree->nodes[x].size = 1;
+  tree->nodes[x].priority = tree->seed;
+  tree->root = ost_insert_node(tree->nodes, tree->root, x);
+  return 0;
+}
+
+
+// Remove one element with the given value, which must be in the tree
+static inline void ost_remove(order_stat_tree *tree, double value)
+{
+  tree->root = ost_remove_node(tree, tree->root, value);
+}
+
+
+// Return the k-th smallest element (counting starts at zero)
+static inline double ost_select(const order_stat_tree *tree, int k)
+{
+  const ost_node *nodes = tree->nodes;
+  int t = tree->root, left_size;
+  
+  while (1) {
+    left_size = nodes[nodes[t].left].size;
+    if (k < left_size)
+      t = nodes[t].left;
+    else if (k == left_size)
+      return nodes[t].value;
+    else {
+      k -= left_size + 1;
+      t = nodes[t].right;
+    }
+  }
+}
+
+
+// Median of the elements in the tree (defined as NAN for an empty tree), see median()
+static inline double ost_median(const order_stat_tree *tree)
+{
+  int n = ost_size(tree);
+  if (n == 0)
+    return NAN;
+  
+  int mid_low = (n - 1) / 2;
+  int mid_high = n - mid_low - 1;
+  double value_low = ost_select(tree, mid_low);
+  if (mid_low < mid_high)   // even number of elements -> two mid points
+    return (value_low + ost_select(tree, mid_high)) / 2;
+  else
+    return value_low;
+}
+
+
+// Sample quantile of the elements in the tree (defined as NAN for an empty tree, or if prob is NAN or outside of
+// [0, 1])
+// -) uses linear interpolation between order statistics, i.e. "type 7" in Hyndman and Fan (1996)
+static inline double ost_quantile(const order_stat_tree *tree, double prob)
+{
+  int n = ost_size(tree), low;
+  double h, value_low;
+  
+  if ((n == 0) || !((prob >= 0) && (prob <= 1)))
+    return NAN;
+  
+  h = (n - 1) * prob;
+  low = (int) floor(h);
+  value_low = ost_select(tree, low);
+  if (low + 1 < n)
+    return value_low + (h - low) * (ost_select(tree, low + 1) - value_low);
+  else
+    return value_low;
+}
+
+
+/*
+Running moments of the values in a rolling time window, which support adding and removing values in O(1)
+-) the mean and sum of squared deviations are updated with Welford's (1962) algorithm, extended to removals
+-) for the third and fourth moment, the power sums of (value - shift) are kept instead, where 'shift' is
+   the first value ever added, in order to reduce the cancellation in the binomial expansion
+-) non-finite values are counted, but not added, so that they do not poison the sums after dropping out
+   of the window
+-) the caller should rebuild the sums from scratch once more values have been removed than are left in
+   the window (see moments_need_rebuild), which bounds the accumulated rounding error and moves 'shift'
+   along with the values, at an amortized cost of O(1) per observation
+*/
+typedef struct {
+  int count;              // number of finite values
+  int num_nonfinite;      // number of non-finite values (NAN or +/-INFINITY)
+  int order;              // highest moment that needs to be calculated (2, 3 or 4)
+  int num_removed;        // number of values removed since the sums were last built from scratch
+  double mean;            // mean of finite values
+  double m2;              // sum of squared deviations from mean
+  double shift;           // shift for power sums
+  double s1, s2, s3, s4;  // sums of (value - shift)^k for k = 1, ..., 4
+} moment_sums;
+
+
+static inline void moments_init(moment_sums *ms, int order)
+{
+  ms->count = ms->num_nonfinite = ms->num_removed = 0;
+  ms->order = order;
+  ms->mean = ms->m2 = 0;
+  ms->shift = NAN;
+  ms->s1 = ms->s2 = ms->s3 = ms->s4 = 0;
+}
+
+
+static inline void moments_add(moment_sums *ms, double value)
+{
+  double delta, y, y2;
+  
+  if (!isfinite(value)) {
+    ms->num_nonfinite++;
+    return;
+  }
+  
+  // Welford update
+  ms->count++;
+  delta = value - ms->mean;
+  ms->mean += delta / ms->count;
+  ms->m2 += delta * (value - ms->mean);
+  
+  // Power sums
+  if (ms->order >= 3) {
+    if (ms->shift != ms->shift)
+      ms->shift = value;
+    y = value - ms->shift;
+    y2 = y * y;
+    ms->s1 += y;
+    ms->s2 += y2;
+    ms->s3 += y2 * y;
+    ms->s4 += y2 * y2;
+  }
+}
+
+
+static inline void moments_remove(moment_sums *ms, double value)
+{
+  double delta, y, y2;
+  
+  ms->num_removed++;
+  if (!isfinite(value)) {
+    ms->num_nonfinite--;
+    return;
+  }
+  
+  // Start from scratch for an empty window, which also discards the accumulated rounding error
+  ms->count--;
+  if (ms->count == 0) {
+    ms->mean = ms->m2 = 0;
+    ms->s1 = ms->s2 = ms->s3 = ms->s4 = 0;
+    return;
+  }
+  
+  // Inverse Welford update
+  delta = value - ms->mean;
+  ms->mean -= delta / ms->count;
+  ms->m2 -= delta * (value - ms->mean);
+  if (ms->m2 < 0)
+    ms->m2 = 0;
+  
+  // Power sums
+  if (ms->order >= 3) {
+    y = value - ms->shift;
+    y2 = y * y;
+    ms->s1 -= y;
+    ms->s2 -= y2;
+    ms->s3 -= y2 * y;
+    ms->s4 -= y2 * y2;
+  }
+}
+
+
+static inline int moments_need_rebuild(const moment_sums *ms)
+{
+  return ms->num_removed > ms->count + ms->num_nonfinite;
+}
+
+
+// m-th central moment (m = 2, 3 or 4), using the same normalization as rolling_central_moment()
+static inline double moments_central(const moment_sums *ms, int m)
+{
+  double k = ms->count, mu, mu2, tmp;
+  
+  if (ms->count + ms->num_nonfinite < 2)
+    return NAN;
+  if (ms->num_nonfinite > 0)
+    return NAN;
+  
+  if (m == 2)
+    return ms->m2 / (k - 1);
+  
+  // Binomial expansion of the sum of (value - mean)^m in terms of the shifted power sums
+  mu = ms->s1 / k;
+  mu2 = mu * mu;
+  if (m == 3)
+    tmp = ms->s3 - 3 * mu * ms->s2 + 2 * k * mu2 * mu;
+  else
+    tmp = ms->s4 - 4 * mu * ms->s3 + 6 * mu2 * ms->s2 - 3 * k * mu2 * mu2;
+  return tmp / (k - 1);
+}
+
+
+
+/*
+Time windows of the rolling operators, which are given either by the observation times and the window widths,
+or by a window plan (see rolling_plan)
+-) the time window of observation i is (t_i - width_before, t_i + width_after], and consists of the
+   observations left, ..., right after calling bounds_move(&bounds, i) for i = 0, 1, ..., n - 1
+-) the check for a window plan is the same for all observations, so it is hoisted out of the loops (or at
+   least perfectly predicted) after bounds_move() has been inlined
+*/
+typedef struct {
+  const double *times;     // array of observation times (NULL for a window plan)
+  double width_before;     // (non-negative) width of rolling window before t_i
+  double width_after;      // (non-negative) width of rolling window after t_i
+  const int *lefts;        // first observation in each time window (NULL if calculated from 'times')
+  const int *rights;       // last observation in each time window (NULL if calculated from 'times')
+  int n;                   // number of observations
+  int left;                // first observation in current time window
+  int right;               // last observation in current time window
+} window_bounds;
+
+
+static inline window_bounds bounds_from_times(const double times[], int n, double width_before,
+  double width_after)
+{
+  window_bounds bounds = {times, width_before, width_after, NULL, NULL, n, 0, -1};
+  return bounds;
+}
+
+
+static inline window_bounds bounds_from_plan(const int lefts[], const int rights[], int n)
+{
+  window_bounds bounds = {NULL, 0, 0, lefts, rights, n, 0, -1};
+  return bounds;
+}
+
+
+// Move to the time window of observation i (where i must not decrease between calls)
+static inline void bounds_move(window_bounds *bounds, int i)
+{
+  if (bounds->lefts != NULL) {
+    STATS_ADD(advances, (bounds->lefts[i] - bounds->left) + (bounds->rights[i] - bounds->right));
+    bounds->left = bounds->lefts[i];
+    bounds->right = bounds->rights[i];
+    STATS_MAX(peak_occupancy, bounds->right - bounds->left + 1);
+    return;
+  }
+  
+  // Expand window on the right
+  const double *times = bounds->times;
+  while ((bounds->right < bounds->n - 1) && (times[bounds->right + 1] <= times[i] + bounds->width_after)) {
+    bounds->right++;
+    STATS_ADD(advances, 1);
+  }
+  
+  // Shrink window on the left
+  while ((bounds->left < bounds->n) && (times[bounds->left] <= times[i] - bounds->width_before)) {
+    bounds->left++;
+    STATS_ADD(advances, 1);
+  }
+  STATS_MAX(peak_occupancy, bounds->right - bounds->left + 1);
+}
+
+
+static inline double sum_combine(double a, double b)
+{
+  return a + b;
+}
+
+
+// Number of the form mantissa * 2^exponent, which can represent products far outside the range of a double
+typedef struct {
+  double mantissa;      // 0.5 <= |mantissa| < 1 after normalization (or zero, infinite, NaN)
+  long long exponent;
+} scaled_double;
+
+
+// Normalize mantissa * 2^exponent, using the exponent bits of the mantissa directly for normal numbers,
+// because frexp() is a library call
+static inline scaled_double scaled_normalize(double mantissa, long long exponent)
+{
+  uint64_t bits;
+  int biased_exponent, shift;
+  scaled_double x;
+  
+  memcpy(&bits, &mantissa, sizeof(double));
+  biased_exponent = (int) ((bits >> 52) & 0x7ff);
+  if ((biased_exponent == 0) || (biased_exponent == 0x7ff)) {
+    // Zero, subnormal number, infinity or NAN
+    x.mantissa = frexp(mantissa, &shift);
+    x.exponent = exponent + shift;
+    return x;
+  }
+  bits = (bits & ~(UINT64_C(0x7ff) << 52)) | (UINT64_C(1022) << 52);
+  memcpy(&x.mantissa, &bits, sizeof(double));
+  x.exponent = exponent + (biased_exponent - 1022);
+  return x;
+}
+
+
+static inline scaled_double scaled_multiply(scaled_double a, scaled_double b)
+{
+  return scaled_normalize(a.mantissa * b.mantissa, a.exponent + b.exponent);
+}
+
+
+// Convert to double, which gives +/-infinity or (+/-) zero if out of range
+static inline double scaled_to_double(scaled_double x)
+{
+  // Multiply by 2^exponent constructed from its bit pattern, which is exact if the result is a normal number
+  if ((x.exponent >= -1000) && (x.exponent <= 1000)) {
+    double scale;
+    uint64_t bits = (uint64_t) (x.exponent + 1023) << 52;
+    memcpy(&scale, &bits, sizeof(double));
+    return x.mantissa * scale;
+  }
+  if (x.exponent > INT_MAX)
+    return x.mantissa * INFINITY;
+  if (x.exponent < INT_MIN)
+    return x.mantissa * 0;
+  return ldexp(x.mantissa, (int) x.exponent);
+}
+
+
+/*
+Loop-carried state of the rolling operators below, which allows to process the observations in several
+consecutive ranges start, ..., end - 1 (see the chunked interface), with exactly the same results as when
+processing all observations 0, ..., n - 1 at once
+-) positions are indices into the arrays 'values' and 'times', which must not change between ranges (except for
+   moving all positions by the same amount, see rolling_chunked_compact)
+-) the deque has the same length n as 'values' and 'times', while the arrays of sliding window aggregation are
+   allocated by the kernels and grow with the number of observations in a time window. All arrays are only
+   allocated for the operators that need them.
+*/
+typedef struct {
+  window_bounds bounds;           // time windows
+  window_bounds bounds_rescan;    // time windows of the second pass for non-integer central moments
+  int left;                       // first observation in current time window
+  int right;                      // last observation in current time window
+  int mid;                        // first observation of back part (see sliding_aggregate)
+  int head;                       // first candidate extremum in 'deque' (see rolling_extremum_kernel)
+  int tail;                       // position after last candidate extremum in 'deque'
+  int num_zeros;                  // number of zeros in current time window (see sliding_product)
+  int front_capacity;             // length of 'front' or 'front_product'
+  double back;                    // aggregate of back part (see sliding_aggregate)
+  scaled_double back_product;     // product of non-zero values of back part (see sliding_product)
+  double roll_sum;                // rolling sum of values (see rolling_sum_stable_kernel)
+  double comp;                    // accumulated numeric error of 'roll_sum'
+  double *front;                  // aggregates of front part (see sliding_aggregate)
+  scaled_double *front_product;   // products of non-zero values of front part (see sliding_product)
+  int *deque;                     // positions of candidate extrema (see rolling_extremum_kernel)
+  order_stat_tree tree;           // values in current time window (see rolling_median_kernel)
+  moment_sums moments;            // running moments (see rolling_central_moment_kernel)
+} rolling_state;
+
+
+// Initialize the state of a rolling operator for the given time windows (without allocating any arrays)
+static inline rolling_state rolling_state_init(window_bounds bounds)
+{
+  rolling_state state;
+  scaled_double one = {1, 0};
+  
+  memset(&state, 0, sizeof(rolling_state));
+  state.bounds = state.bounds_rescan = bounds;
+  state.right = -1;
+  state.back_product = one;
+  state.front = NULL;
+  state.front_product = NULL;
+  state.deque = NULL;
+  ost_init(&state.tree);
+  moments_init(&state.moments, 2);
+  return state;
+}
+
+
+// Increase the capacity of the front part of sliding window aggregation to at least 'capacity_min' elements
+// -) the array is allocated on the first call even if 'capacity_min' is zero (i.e. for an empty time window),
+//    so that NULL is only returned if out of memory, in which case the array is left unchanged
+// -) returns the (possibly moved) array
+static void *front_reserve(void *front, int *capacity, int capacity_min, size_t element_size)
+{
+  int capacity_new = (*capacity > 0) ? *capacity : 16;
+  
+  if ((front != NULL) && (*capacity >= capacity_min))
+    return front;
+  while (capacity_new < capacity_min)
+    capacity_new = (capacity_new <= INT_MAX / 2) ? 2 * capacity_new : capacity_min;
+  
+  void *front_new = realloc(front, (size_t) capacity_new * element_size);
+  if (front_new != NULL)
+    *capacity = capacity_new;
+  return front_new;
+}
+
+
+/*
+Sliding window aggregation for an associative operation via the "two stacks" algorithm
+-) the time window [left, right] is split into a front part [left, mid) and a back part [mid, right]. For the
+   front part, the aggregates values[j] + ... + values[mid-1] ("+" denoting the operation) are stored for each j,
+   while for the back part, only the aggregate of all values is stored. When the front part becomes empty,
+   the back part is turned into the front part by calculating the aggregates from right to left.
+-) the operation is never inverted, so there is no loss of precision (e.g. for sums) or special case
+   (e.g. for products with zeros) when an observation leaves the time window, and the operation need not be
+   commutative
+-) each observation is combined at most twice, plus once per output, i.e. O(1) amortized time per observation
+   (but O(N) for the observation that triggers the recalculation of the front part, where N is the number of
+   observations in the time window)
+-) the aggregate starting at position j is stored in state->front[mid - 1 - j], so that the array only needs
+   as many elements as the largest time window (it is grown by front_reserve), and does not change when all
+   positions are moved by the same amount
+-) state->back must be initialized to the identity element
+-) returns 0 on success, and -1 if out of memory, in which case the output of the remaining observations is NAN
+*/
+static inline int sliding_aggregate(const double values[], rolling_state *state, double values_new[],
+  double (*combine)(double, double), double identity, int average, int start, int end)
+{
+  // state      ... loop-carried state, see rolling_state
+  // combine    ... associative operation
+  // identity   ... identity element of operation, which is returned for an empty time window
+  // average    ... divide aggregate by number of observations in time window (non-zero), or not (zero)?
+  // start, end ... range of observations to process
+  
+  window_bounds bounds = state->bounds;
+  int left = state->left, right = state->right, mid = state->mid, status = 0;
+  double back = state->back, *front = state->front;
+  
+  STATS_BEGIN();
+  for (int i = start; i < end; i++) {
+    // Expand window on the right, and shrink window on the left
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      back = combine(back, values[right]);
+    }
+    left = bounds.left;
+    
+    // Turn back part into front part if the front part is empty
+    if (left >= mid) {
+      double aggregate = identity;
+      front = front_reserve(state->front, &state->front_capacity, right - left + 1, sizeof(double));
+      if (front == NULL) {
+        // Out of memory
+        for (int j = i; j < end; j++)
+          values_new[j] = NAN;
+        front = state->front;
+        status = -1;
+        break;
+      }
+      state->front = front;
+      STATS_RESCAN(right - left + 1, 1);
+      for (int j = right; j >= left; j--) {
+        aggregate = combine(values[j], aggregate);
+        front[right - j] = aggregate;
+      }
+      mid = right + 1;
+      back = identity;
+    }
+    
+    // Aggregate of time window
+    values_new[i] = combine((left < mid) ? front[mid - 1 - left] : identity, back);
+    if (average)
+      values_new[i] = (left <= right) ? values_new[i] / (right - left + 1) : NAN;
+  }
+  state->bounds = bounds;
+  state->left = left;
+  state->right = right;
+  state->mid = mid;
+  state->back = back;
+  STATS_END();
+  return status;
+}
+
+
+/*
+Rolling product of observation values via sliding window aggregation (see sliding_aggregate)
+-) the zeros in the time window are counted instead of multiplied, and the product of the non-zero values is
+   stored as a scaled_double, so that partial products of long time windows neither overflow nor underflow
+-) like state->front, state->front_product is indexed relative to 'mid' and grown by front_reserve
+-) returns 0 on success, and -1 if out of memory, in which case the output of the remaining observations is NAN
+*/
+static int sliding_product(const double values[], rolling_state *state, double values_new[], int start, int end)
+{
+  window_bounds bounds = state->bounds;
+  int left = state->left, right = state->right, mid = state->mid, num_zeros = state->num_zeros, status = 0;
+  scaled_double one = {1, 0}, back = state->back_product, *front = state->front_product;
+  
+  STATS_BEGIN();
+  for (int i = start; i < end; i++) {
+    // Expand window on the right
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      if (values[right] == 0)
+        num_zeros++;
+      else
+        back = scaled_multiply(back, scaled_normalize(values[right], 0));
+    }
+    
+    // Shrink window on the left
+    while (left < bounds.left) {
+      if (values[left] == 0)
+        num_zeros--;
+      left++;
+    }
+    
+    // Turn back part into front part if the front part is empty
+    if (left >= mid) {
+      scaled_double aggregate = one;
+      front = front_reserve(state->front_product, &state->front_capacity, right - left + 1, sizeof(scaled_double));
+      if (front == NULL) {
+        // Out of memory
+        for (int j = i; j < end; j++)
+          values_new[j] = NAN;
+        front = state->front_product;
+        status = -1;
+        break;
+      }
+      state->front_product = front;
+      STATS_RESCAN(right - left + 1, 1);
+      for (int j = right; j >= left; j--) {
+        if (values[j] != 0)
+          aggregate = scaled_multiply(scaled_normalize(values[j], 0), aggregate);
+        front[right - j] = aggregate;
+      }
+      mid = right + 1;
+      back = one;
+    }
+    
+    // Product of time window
+    if (num_zeros > 0)
+      values_new[i] = 0;
+    else
+      values_new[i] = scaled_to_double(scaled_multiply((left < mid) ? front[mid - 1 - left] : one, back));
+  }
+  state->bounds = bounds;
+  state->left = left;
+  state->right = right;
+  state->mid = mid;
+  state->num_zeros = num_zeros;
+  state->back_product = back;
+  STATS_END();
+  return status;
+}
+
+
+static void rolling_num_obs_kernel(rolling_state *state, double values_new[], int start, int end)
+{
+  window_bounds bounds = state->bounds;
+  
+  STATS_BEGIN();
+  for (int i = start; i < end; i++) {
+    bounds_move(&bounds, i);
+    values_new[i] = bounds.right - bounds.left + 1;
+  }
+  state->bounds = bounds;
+  STATS_END();
+}
+
+
+// Rolling sum using Kahan (1965) summation algorithm
+static void rolling_sum_stable_kernel(const double values[], rolling_state *state, double values_new[], int start,
+  int end)
+{
+  window_bounds bounds = state->bounds;
+  int left = state->left, right = state->right;
+  double roll_sum = state->roll_sum, comp = state->comp;
+  
+  STATS_BEGIN();
+  for (int i = start; i < end; i++) {
+    // Expand window on the right
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      compensated_addition(&roll_sum, values[right], &comp);
+    }
+    
+    // Shrink window on the left
+    while (left < bounds.left) {
+      compensated_addition(&roll_sum, -values[left], &comp);
+      left++;
+    }
+    
+    values_new[i] = roll_sum;
+  }
+  state->bounds = bounds;
+  state->left = left;
+  state->right = right;
+  state->roll_sum = roll_sum;
+  state->comp = comp;
+  STATS_END();
+}
+
+
+// Rolling maximum or minimum using a monotonic deque
+// -) state->deque must be an array of length n
+static void rolling_extremum_kernel(const double values[], rolling_state *state, double values_new[], int maximum,
+  int start, int end)
+{
+  // maximum ... calculate rolling maximum (non-zero) or rolling minimum (zero)?
+  
+  window_bounds bounds = state->bounds;
+  int right = state->right, head = state->head, tail = state->tail;
+  
+  // Positions of candidate extrema, with decreasing (maximum) or increasing (minimum) values from head to tail
+  // -) each position is added at most once, so the deque never wraps around
+  int *deque = state->deque;
+  
+  STATS_BEGIN();
+  for (int i = start; i < end; i++) {
+    // Expand window on the right
+    // -) positions with values <= (maximum) or >= (minimum) the new value can never be the (most recent)
+    //    extremum again
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      if (maximum) {
+        while ((tail > head) && (values[deque[tail - 1]] <= values[right]))
+          tail--;
+      } else {
+        while ((tail > head) && (values[deque[tail - 1]] >= values[right]))
+          tail--;
+      }
+      deque[tail++] = right;
+    }
+    
+    // Shrink window on the left
+    while ((head < tail) && (deque[head] < bounds.left))
+      head++;
+    
+    // Save extremum in current time window
+    if (head < tail)  // non-empty window
+      values_new[i] = values[deque[head]];
+    else              // empty window
+      values_new[i] = maximum ? -INFINITY : INFINITY;
+  }
+  state->bounds = bounds;
+  state->right = right;
+  state->head = head;
+  state->tail = tail;
+  STATS_END();
+}
+
+
+// Rolling median using an order statistic tree (returns 0 on success, and -1 if out of memory)
+static int rolling_median_kernel(const double values[], rolling_state *state, double values_new[], int start,
+  int end)
+{
+  window_bounds bounds = state->bounds;
+  int left = state->left, right = state->right, status = 0;
+  
+  STATS_BEGIN();
+  for (int i = start; i < end; i++) {
+    // Expand window on the right
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      if (ost_insert(&state->tree, values[right]) != 0) {
+        // Out of memory
+        for (int j = i; j < end; j++)
+          values_new[j] = NAN;
+        status = -1;
+        break;
+      }
+    }
+    if (status != 0)
+      break;
+    
+    // Shrink window on the left end
+    while (left < bounds.left) {
+      ost_remove(&state->tree, values[left]);
+      left++;
+    }
+    
+    // Median of values in rolling window
+    values_new[i] = ost_median(&state->tree);
+  }
+  state->bounds = bounds;
+  state->left = left;
+  state->right = right;
+  STATS_END();
+  return status;
+}
+
+
+/*
+Rolling m-th central moment
+-) for m = 2, 3, 4, state->moments must have been initialized with moments_init(&state->moments, m)
+-) for other m, the rolling mean is calculated via sliding window aggregation (see sliding_aggregate), so the
+   output is NAN if out of memory
+*/
+static void rolling_central_moment_kernel(const double values[], rolling_state *state, double values_new[],
+  double m, int start, int end)
+{
+  // m ... which moment to calculate (non-negative number)
+  
+  window_bounds bounds;
+  int left = state->left, right = state->right;
+  double tmp;
+  
+  STATS_BEGIN();
+  
+  // Integer moments of order 2-4
+  if ((m == 2) || (m == 3) || (m == 4)) {
+    moment_sums ms = state->moments;
+    bounds = state->bounds;
+    
+    for (int i = start; i < end; i++) {
+      // Expand window on the right
+      bounds_move(&bounds, i);
+      while (right < bounds.right) {
+        right++;
+        moments_add(&ms, values[right]);
+      }
+      
+      // Shrink window on the left
+      while (left < bounds.left) {
+        moments_remove(&ms, values[left]);
+        left++;
+      }
+      if (moments_need_rebuild(&ms)) {
+        STATS_RESCAN(right - left + 1, 1);
+        moments_init(&ms, (int) m);
+        for (int pos = left; pos <= right; pos++)
+          moments_add(&ms, values[pos]);
+      }
+      
+      values_new[i] = moments_central(&ms, (int) m);
+    }
+    state->bounds = bounds;
+    state->left = left;
+    state->right = right;
+    state->moments = ms;
+    STATS_END();
+    return;
+  }
+  
+  // Calculate the rolling first moment, which is overwritten by the m-th central moment below
+  sliding_aggregate(values, state, values_new, sum_combine, 0, 1, start, end);
+  
+  // Calculate m-th central moment
+  bounds = state->bounds_rescan;
+  for (int i = start; i < end; i++) {
+    bounds_move(&bounds, i);
+    left = bounds.left;
+    right = bounds.right;
+    
+    // Calculate m-th central moment in current time window
+    if (left < right) {   // two or more observations in time window
+      STATS_RESCAN(right - left + 1, 0);
+      tmp = 0;
+      for (int pos = left; pos <= right; pos++)
+        tmp = tmp + pow(values[pos] - values_new[i], m);
+      values_new[i] = tmp / (right - left);
+    } else
+      values_new[i] = NAN;
+  }
+  state->bounds_rescan = bounds;
+  STATS_END();
+}
+
+
+static void rolling_num_obs_helper(window_bounds bounds, double values_new[])
+{
+  rolling_state state = rolling_state_init(bounds);
+  rolling_num_obs_kernel(&state, values_new, 0, bounds.n);
+}
+
+
+static void rolling_sum_helper(const double values[], window_bounds bounds, double values_new[], int average)
+{
+  // average ... calculate rolling average (non-zero) or rolling sum (zero)?
+  
+  rolling_state state = rolling_state_init(bounds);
+  sliding_aggregate(values, &state, values_new, sum_combine, 0, average, 0, bounds.n);
+  free(state.front);
+}
+
+
+static void rolling_sum_stable_helper(const double values[], window_bounds bounds, double values_new[])
+{
+  rolling_state state = rolling_state_init(bounds);
+  rolling_sum_stable_kernel(values, &state, values_new, 0, bounds.n);
+}
+
+
+static void rolling_product_helper(const double values[], window_bounds bounds, double values_new[])
+{
+  rolling_state state = rolling_state_init(bounds);
+  sliding_product(values, &state, values_new, 0, bounds.n);
+  free(state.front_product);
+}
+
+
+static void rolling_extremum_helper(const double values[], window_bounds bounds, double values_new[], int maximum)
+{
+  // maximum ... calculate rolling maximum (non-zero) or rolling minimum (zero)?
+  
+  rolling_state state = rolling_state_init(bounds);
+  state.deque = malloc(bounds.n * sizeof(int));
+  if (state.deque == NULL) {
+    // Out of memory
+    for (int i = 0; i < bounds.n; i++)
+      values_new[i] = NAN;
+    return;
+  }
+  rolling_extremum_kernel(values, &state, values_new, maximum, 0, bounds.n);
+  free(state.deque);
+}
+
+
+static void rolling_median_helper(const double values[], window_bounds bounds, double values_new[])
+{
+  rolling_state state = rolling_state_init(bounds);
+  rolling_median_kernel(values, &state, values_new, 0, bounds.n);
+  ost_free(&state.tree);
+}
+
+
+static void rolling_central_moment_helper(const double values[], window_bounds bounds, double values_new[],
+  double m)
+{
+  // m ... which moment to calculate (non-negative number)
+  
+  rolling_state state = rolling_state_init(bounds);
+  if ((m == 2) || (m == 3) || (m == 4))
+    moments_init(&state.moments, (int) m);
+  rolling_central_moment_kernel(values, &state, values_new, m, 0, bounds.n);
+  free(state.front);
+}
+
 /****************** END: Helper functions ****************/
 
 
-// Rolling number of observation values
-void rolling_num_obs(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+/******************* Window plans ********************/
+
+/*
+Calculate the window plan of a time series, i.e. the first and last observation in each rolling time window
+-) the time window of observation i is (t_i - width_before, t_i + width_after], like for all rolling_* operators,
+   and consists of the observations lefts[i], ..., rights[i] (i.e. it is empty if lefts[i] > rights[i])
+-) the plan depends only on the observation times and the window widths, so it can be calculated once and
+   reused for several operators and several value columns with the same observation times, e.g. bid and ask
+-) the *_plan versions of the rolling operators do not compare observation times, so their loops are simpler
+   and more predictable than the ones of the original functions, which calculate the time windows on the fly.
+   The results are identical.
+*/
+void rolling_plan(const double times[], const int *n, const double *width_before, const double *width_after,
+  int lefts[], int rights[])
+{
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'times'
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // lefts        ... array of length *n to store the first observation in each time window
+  // rights       ... array of length *n to store the last observation in each time window
+  
+  window_bounds bounds = bounds_from_times(times, *n, *width_before, *width_after);
+  
+  for (int i = 0; i < *n; i++) {
+    bounds_move(&bounds, i);
+    lefts[i] = bounds.left;
+    rights[i] = bounds.right;
+  }
+}
+
+
+// Rolling number of observation values for a window plan
+// -) unlike rolling_num_obs(), there is no argument for the values, because the output only depends on the plan
+void rolling_num_obs_plan(const int lefts[], const int rights[], const int *n, double values_new[])
+{
+  // lefts      ... array of first observation in each time window, see rolling_plan()
+  // rights     ... array of last observation in each time window, see rolling_plan()
+  // n          ... number of observations, i.e. length of 'lefts' and 'rights'
+  // values_new ... array of length *n to store output time series values
+  
+  rolling_num_obs_helper(bounds_from_plan(lefts, rights, *n), values_new);
+}
+
+
+// Rolling sum of observation values for a window plan
+void rolling_sum_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // values     ... array of time series values
+  // lefts      ... array of first observation in each time window, see rolling_plan()
+  // rights     ... array of last observation in each time window, see rolling_plan()
+  // n          ... number of observations, i.e. length of 'values', 'lefts' and 'rights'
+  // values_new ... array of length *n to store output time series values
+  
+  rolling_sum_helper(values, bounds_from_plan(lefts, rights, *n), values_new, 0);
+}
+
+
+// Rolling sum of observation values for a window plan, using Kahan (1965) summation algorithm
+void rolling_sum_stable_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_sum_stable_helper(values, bounds_from_plan(lefts, rights, *n), values_new);
+}
+
+
+// Rolling product of observation values for a window plan
+void rolling_product_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_product_helper(values, bounds_from_plan(lefts, rights, *n), values_new);
+}
+
+
+// Rolling average of observation values for a window plan
+void rolling_mean_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_sum_helper(values, bounds_from_plan(lefts, rights, *n), values_new, 1);
+}
+
+
+// Rolling maximum of observation values for a window plan
+void rolling_max_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_extremum_helper(values, bounds_from_plan(lefts, rights, *n), values_new, 1);
+}
+
+
+// Rolling minimum of observation values for a window plan
+void rolling_min_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_extremum_helper(values, bounds_from_plan(lefts, rights, *n), values_new, 0);
+}
+
+
+// Rolling median of observation values for a window plan
+void rolling_median_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_median_helper(values, bounds_from_plan(lefts, rights, *n), values_new);
+}
+
+
+// Rolling central moment of observation values for a window plan
+void rolling_central_moment_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[], const double *m)
+{
+  // m ... which moment to calculate (non-negative number), all other arguments are the same as for
+  //       rolling_sum_plan()
+  
+  rolling_central_moment_helper(values, bounds_from_plan(lefts, rights, *n), values_new, *m);
+}
+
+
+// Rolling standard deviation of observation values for a window plan
+void rolling_sd_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_central_moment_helper(values, bounds_from_plan(lefts, rights, *n), values_new, 2);
+  for (int i = 0; i < *n; i++)
+    values_new[i] = sqrt(values_new[i]);
+}
+
+
+// Rolling variance of observation values for a window plan
+void rolling_var_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[])
+{
+  // all arguments are the same as for rolling_sum_plan()
+  
+  rolling_central_moment_helper(values, bounds_from_plan(lefts, rights, *n), values_new, 2);
+}
+
+/****************** END: Window plans ****************/
+
+
+
+// Rolling number of observation values
+void rolling_num_obs(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  (void) values;
+  rolling_num_obs_helper(bounds_from_times(times, *n, *width_before, *width_after), values_new);
+}
+
+
+// Rolling sum of observation values
+void rolling_sum(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  rolling_sum_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new, 0);
+}
+
+
+// Same as rolling_sum, but use Kahan (1965) summation algorithm to reduce numerical error
+void rolling_sum_stable(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  rolling_sum_stable_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new);
+}
+
+
+
+// Rolling product of observation values
+void rolling_product(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  rolling_product_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new);
+}
+
+
+// Rolling average of observation values
+void rolling_mean(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  rolling_sum_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new, 1);
+}
+
+
+// Rolling sums or averages for several rolling time windows in a single pass, see rolling_sum_multi()
+static void rolling_sum_multi_helper(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths, int average)
+{
+  // average ... calculate rolling average (non-zero) or rolling sum (zero)?
+  
+  int left, right, num = *num_widths;
+  double roll_sum;
+  
+  // State of each rolling window
+  int *lefts = malloc(2 * num * sizeof(int)), *rights = lefts + num;
+  double *roll_sums = malloc(num * sizeof(double));
+  if ((lefts == NULL) || (roll_sums == NULL)) {
+    // Out of memory
+    for (int i = 0; i < *n * num; i++)
+      values_new[i] = NAN;
+    free(lefts);
+    free(roll_sums);
+    return;
+  }
+  for (int k = 0; k < num; k++) {
+    lefts[k] = 0;
+    rights[k] = -1;
+    roll_sums[k] = 0;
+  }
+  
+  for (int i = 0; i < *n; i++) {
+    for (int k = 0; k < num; k++) {
+      left = lefts[k];
+      right = rights[k];
+      roll_sum = roll_sums[k];
+      
+      // Expand window on the right
+      while ((right < *n - 1) && (times[right + 1] <= times[i] + widths_after[k])) {
+        right++;
+        roll_sum = roll_sum + values[right];
+      }
+      
+      // Shrink window on the left
+      while ((left < *n) && (times[left] <= times[i] - widths_before[k])) {
+        roll_sum = roll_sum - values[left];
+        left++;
+      }
+      
+      // Save rolling sum or average
+      if (!average)
+        values_new[i + k * (*n)] = roll_sum;
+      else if (left <= right)  // non-empty window
+        values_new[i + k * (*n)] = roll_sum / (right - left + 1);
+      else                     // empty window
+        values_new[i + k * (*n)] = NAN;
+      lefts[k] = left;
+      rights[k] = right;
+      roll_sums[k] = roll_sum;
+    }
+  }
+  free(lefts);
+  free(roll_sums);
+}
+
+
+// Rolling sum of observation values for several rolling time windows in a single pass
+// -) reads 'values' and 'times' only once, and agrees with calling rolling_sum() once for each window up to
+//    rounding errors, because the rolling sums are updated by adding and subtracting values instead of via
+//    sliding window aggregation
+void rolling_sum_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths)
+{
+  // values        ... array of time series values
+  // times         ... array of observation times
+  // n             ... number of observations, i.e. length of 'values' and 'times'
+  // values_new    ... array of length (*n) * (*num_widths) to store output in column-major order, i.e. the
+  //                   rolling sum for the k-th window at time t_i is stored in values_new[i + k * (*n)]
+  // widths_before ... array of (non-negative) widths of rolling window before t_i
+  // widths_after  ... array of (non-negative) widths of rolling window after t_i
+  // num_widths    ... number of rolling windows, i.e. length of 'widths_before' and 'widths_after'
+  
+  rolling_sum_multi_helper(values, times, n, values_new, widths_before, widths_after, num_widths, 0);
+}
+
+
+// Rolling average of observation values for several rolling time windows in a single pass
+// -) reads 'values' and 'times' only once, and agrees with calling rolling_mean() once for each window up to
+//    rounding errors, because the rolling sums are updated by adding and subtracting values instead of via
+//    sliding window aggregation
+void rolling_mean_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths)
+{
+  // values        ... array of time series values
+  // times         ... array of observation times
+  // n             ... number of observations, i.e. length of 'values' and 'times'
+  // values_new    ... array of length (*n) * (*num_widths) to store output in column-major order, i.e. the
+  //                   rolling mean for the k-th window at time t_i is stored in values_new[i + k * (*n)]
+  // widths_before ... array of (non-negative) widths of rolling window before t_i
+  // widths_after  ... array of (non-negative) widths of rolling window after t_i
+  // num_widths    ... number of rolling windows, i.e. length of 'widths_before' and 'widths_after'
+  
+  rolling_sum_multi_helper(values, times, n, values_new, widths_before, widths_after, num_widths, 1);
+}
+
+
+// Rolling maximum of observation values
+// -) the candidate maxima are kept in a monotonic deque, so that the run-time is O(N) for any input
+void rolling_max(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times matching time series values
+  // n            ... length of 'values'
+  // values_new   ... array (of same length as 'values') used to store output
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  rolling_extremum_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new, 1);
+}
+
+
+// Rolling minimum of observation values
+// -) the candidate minima are kept in a monotonic deque, so that the run-time is O(N) for any input
+void rolling_min(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times matching time series values
+  // n            ... length of 'values'
+  // values_new   ... array (of same length as 'values') used to store output
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  rolling_extremum_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new, 0);
+}
+
+
+// Rolling median
+// -) the values in the rolling window are kept in an order statistic tree, so that the run-time is
+//    O(N log w), where w is the largest number of observations in a time window
+void rolling_median(const double values[], const double times[], const int *n, double values_new[], 
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times matching time series values
+  // n            ... length of 'values'
+  // values_new   ... array (of same length as 'values') used to store output
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  rolling_median_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new);
+}
+
+
+// Rolling quantiles for several probabilities at once
+// -) all quantiles are calculated from the same order statistic tree, so that the run-time is
+//    O(N log w) per quantile, where w is the largest number of observations in a time window
+// -) see ost_quantile() for the definition of a sample quantile
+void rolling_quantile(const double values[], const double times[], const int *n, double values_new[], 
+  const double *width_before, const double *width_after, const double probs[], const int *num_probs)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times matching time series values
+  // n            ... length of 'values'
+  // values_new   ... array of length (*n) * (*num_probs) used to store output in column-major order, i.e.
+  //                  the quantile for probs[j] at time t_i is stored in values_new[i + j * (*n)]
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // probs        ... array of probabilities between zero and one (the output is NAN for other probabilities)
+  // num_probs    ... number of probabilities, i.e. length of 'probs'
+  
+  window_bounds bounds = bounds_from_times(times, *n, *width_before, *width_after);
+  int left = 0, right = -1;
+  order_stat_tree tree;
+  
+  STATS_BEGIN();
+  ost_init(&tree);
+  for (int i = 0; i < *n; i++) {
+    // Expand window on the right
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      if (ost_insert(&tree, values[right]) != 0) {
+        // Out of memory
+        for (int j = 0; j < *num_probs; j++)
+          for (int k = i; k < *n; k++)
+            values_new[k + j * (*n)] = NAN;
+        ost_free(&tree);
+        STATS_END();
+        return;
+      }
+    }
+    
+    // Shrink window on the left end
+    while (left < bounds.left) {
+      ost_remove(&tree, values[left]);
+      left++;
+    }
+    
+    // Quantiles of values in rolling window
+    for (int j = 0; j < *num_probs; j++)
+      values_new[i + j * (*n)] = ost_quantile(&tree, probs[j]);
+  }
+  ost_free(&tree);
+  STATS_END();
+}
+
+
+// Several rolling statistics of the same time series in a single pass
+// -) shares the window boundary calculation and reads 'values' and 'times' only once, which is faster than
+//    calling the individual functions if the run-time is limited by memory bandwidth
+// -) the sum and mean agree with the ones of the individual functions only up to rounding errors, because the
+//    rolling sum is updated by adding and subtracting values instead of via sliding window aggregation (see
+//    rolling_sum), while all other statistics are identical
+void rolling_stats(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *stats)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length (*n) * (number of requested statistics) to store output in column-major
+  //                  order, with one column per requested statistic in the order of the ROLLING_* constants
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // stats        ... bitmask of requested statistics, e.g. (1 << ROLLING_SUM) | (1 << ROLLING_MAX). Supported
+  //                  are ROLLING_NUM_OBS, ROLLING_SUM, ROLLING_MEAN, ROLLING_MAX, ROLLING_MIN, ROLLING_SD,
+  //                  and ROLLING_VAR
+  
+  window_bounds bounds = bounds_from_times(times, *n, *width_before, *width_after);
+  int left = 0, right = -1, num_obs, max_head = 0, max_tail = 0, min_head = 0, min_tail = 0;
+  int *max_deque = NULL, *min_deque = NULL;
+  double roll_sum = 0, var;
+  double *out_num_obs = NULL, *out_sum = NULL, *out_mean = NULL, *out_max = NULL, *out_min = NULL;
+  double *out_sd = NULL, *out_var = NULL;
+  moment_sums ms;
+  
+  // Assign output columns
+  double *out = values_new;
+  if (*stats & (1 << ROLLING_NUM_OBS)) {
+    out_num_obs = out;
+    out += *n;
+  }
+  if (*stats & (1 << ROLLING_SUM)) {
+    out_sum = out;
+    out += *n;
+  }
+  if (*stats & (1 << ROLLING_MEAN)) {
+    out_mean = out;
+    out += *n;
+  }
+  if (*stats & (1 << ROLLING_MAX)) {
+    out_max = out;
+    out += *n;
+  }
+  if (*stats & (1 << ROLLING_MIN)) {
+    out_min = out;
+    out += *n;
+  }
+  if (*stats & (1 << ROLLING_SD)) {
+    out_sd = out;
+    out += *n;
+  }
+  if (*stats & (1 << ROLLING_VAR))
+    out_var = out;
+  
+  // Workspace, see rolling_max(), rolling_min() and rolling_central_moment()
+  int do_sum = (out_sum != NULL) || (out_mean != NULL);
+  int do_moments = (out_sd != NULL) || (out_var != NULL);
+  // -) if out of memory, the maximum or minimum is NAN, while the other statistics are still calculated
+  if ((out_max != NULL) && ((max_deque = malloc(*n * sizeof(int))) == NULL)) {
+    for (int i = 0; i < *n; i++)
+      out_max[i] = NAN;
+    out_max = NULL;
+  }
+  if ((out_min != NULL) && ((min_deque = malloc(*n * sizeof(int))) == NULL)) {
+    for (int i = 0; i < *n; i++)
+      out_min[i] = NAN;
+    out_min = NULL;
+  }
+  moments_init(&ms, 2);
+  
+  STATS_BEGIN();
+  for (int i = 0; i < *n; i++) {
+    // Expand window on the right
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      if (do_sum)
+        roll_sum = roll_sum + values[right];
+      if (do_moments)
+        moments_add(&ms, values[right]);
+      if (max_deque != NULL) {
+        while ((max_tail > max_head) && (values[max_deque[max_tail - 1]] <= values[right]))
+          max_tail--;
+        max_deque[max_tail++] = right;
+      }
+      if (min_deque != NULL) {
+        while ((min_tail > min_head) && (values[min_deque[min_tail - 1]] >= values[right]))
+          min_tail--;
+        min_deque[min_tail++] = right;
+      }
+    }
+    
+    // Shrink window on the left
+    while (left < bounds.left) {
+      if (do_sum)
+        roll_sum = roll_sum - values[left];
+      if (do_moments)
+        moments_remove(&ms, values[left]);
+      left++;
+    }
+    if (do_moments && moments_need_rebuild(&ms)) {
+      STATS_RESCAN(right - left + 1, 1);
+      moments_init(&ms, 2);
+      for (int pos = left; pos <= right; pos++)
+        moments_add(&ms, values[pos]);
+    }
+    
+    // Save requested statistics for current time window
+    num_obs = right - left + 1;
+    if (out_num_obs != NULL)
+      out_num_obs[i] = num_obs;
+    if (out_sum != NULL)
+      out_sum[i] = roll_sum;
+    if (out_mean != NULL)
+      out_mean[i] = (num_obs > 0) ? roll_sum / num_obs : NAN;
+    if (out_max != NULL) {
+      while ((max_head < max_tail) && (max_deque[max_head] < left))
+        max_head++;
+      out_max[i] = (max_head < max_tail) ? values[max_deque[max_head]] : -INFINITY;
+    }
+    if (out_min != NULL) {
+      while ((min_head < min_tail) && (min_deque[min_head] < left))
+        min_head++;
+      out_min[i] = (min_head < min_tail) ? values[min_deque[min_head]] : INFINITY;
+    }
+    if (do_moments) {
+      var = moments_central(&ms, 2);
+      if (out_sd != NULL)
+        out_sd[i] = sqrt(var);
+      if (out_var != NULL)
+        out_var[i] = var;
+    }
+  }
+  free(max_deque);
+  free(min_deque);
+  STATS_END();
+}
+
+
+// Rolling central moment of observation values
+// -) for m = 2, 3, 4 the moments are updated incrementally in O(1) per observation (see moment_sums), while
+//    other moments require O(w) calls to pow() per observation, where w is the number of observations in
+//    the time window
+void rolling_central_moment(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const double *m)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // m            ... which moment to calculate (non-negative number)
+  
+  rolling_central_moment_helper(values, bounds_from_times(times, *n, *width_before, *width_after), values_new, *m);
+}
+
+
+
+// Rolling standard deviation of observation values
+void rolling_sd(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  double moment = 2;
+  rolling_central_moment(values, times, n, values_new, width_before, width_after, &moment);
+  for (int i = 0; i < *n; i++)
+    values_new[i] = sqrt(values_new[i]);
+}
+
+
+// Rolling variance of observation values
+void rolling_var(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  double moment = 2;
+  rolling_central_moment(values, times, n, values_new, width_before, width_after, &moment);
+}
+
+
+
+/*
+Rolling aggregate of observation values for an arbitrary associative operation, e.g. fmax() or a user-defined
+function, using sliding window aggregation (see sliding_aggregate)
+-) the operation is applied to the values in the time window in order of their observation times, i.e. the
+   result is values[left] + ... + values[right], where "+" denotes the operation
+*/
+void rolling_aggregate(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, rolling_combine combine, const double *identity)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // combine      ... associative operation
+  // identity     ... identity element of operation, which is returned for an empty time window
+  
+  rolling_state state = rolling_state_init(bounds_from_times(times, *n, *width_before, *width_after));
+  
+  state.back = *identity;
+  sliding_aggregate(values, &state, values_new, combine, *identity, 0, 0, *n);
+  free(state.front);
+}
+
+
+// Same as rolling_aggregate(), but for observation values of an arbitrary type, e.g. a struct
+// -) returns 0 on success, and -1 if out of memory, in which case the output is incomplete
+int rolling_aggregate_generic(const void *values, const double times[], const int *n, void *values_new,
+  const int *size, const double *width_before, const double *width_after, rolling_combine_generic combine,
+  const void *identity, void *context)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // size         ... size of each value in bytes
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  // combine      ... associative operation, which stores the result of combining 'a' and 'b' in 'result'
+  // identity     ... identity element of operation, which is returned for an empty time window
+  // context      ... passed unchanged to each call of 'combine', e.g. for parameters of the operation
+  
+  window_bounds bounds = bounds_from_times(times, *n, *width_before, *width_after);
+  const char *x = values;
+  char *x_new = values_new, *front = NULL;
+  int left = 0, right = -1, mid = 0, front_capacity = 0, status = 0;
+  size_t bytes = *size;
+  
+  // Aggregate of back part, and temporary value (see sliding_aggregate)
+  char *back = malloc(2 * bytes), *tmp = back + bytes;
+  if (back == NULL)
+    return -1;
+  
+  STATS_BEGIN();
+  memcpy(back, identity, bytes);
+  for (int i = 0; i < *n; i++) {
+    // Expand window on the right, and shrink window on the left
+    bounds_move(&bounds, i);
+    while (right < bounds.right) {
+      right++;
+      combine(tmp, back, x + right * bytes, context);
+      memcpy(back, tmp, bytes);
+    }
+    left = bounds.left;
+    
+    // Turn back part into front part if the front part is empty
+    // -) the aggregate starting at position j is stored at position mid - 1 - j of 'front'
+    if (left >= mid) {
+      char *front_new = front_reserve(front, &front_capacity, right - left + 1, bytes);
+      if (front_new == NULL) {
+        status = -1;
+        break;
+      }
+      front = front_new;
+      STATS_RESCAN(right - left + 1, 1);
+      memcpy(tmp, identity, bytes);
+      for (int j = right; j >= left; j--) {
+        combine(front + (right - j) * bytes, x + j * bytes, tmp, context);
+        memcpy(tmp, front + (right - j) * bytes, bytes);
+      }
+      mid = right + 1;
+      memcpy(back, identity, bytes);
+    }
+    
+    // Aggregate of time window
+    combine(x_new + i * bytes, (left < mid) ? front + (mid - 1 - left) * bytes : identity, back, context);
+  }
+  free(front);
+  free(back);
+  STATS_END();
+  return status;
+}
+
+
+/******************* Multi-threaded interface ********************/
+
+// Same as rolling_num_obs(), but use several threads (see apply_parallel)
+void rolling_num_obs_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_num_obs()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_num_obs, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_sum(), but use several threads (see apply_parallel)
+void rolling_sum_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_sum()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_sum, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_sum_stable(), but use several threads (see apply_parallel)
+void rolling_sum_stable_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_sum_stable()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_sum_stable, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_product(), but use several threads (see apply_parallel)
+void rolling_product_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_product()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_product, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_mean(), but use several threads (see apply_parallel)
+void rolling_mean_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_mean()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_mean, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_max(), but use several threads (see apply_parallel)
+void rolling_max_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_max()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_max, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_min(), but use several threads (see apply_parallel)
+void rolling_min_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_min()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_min, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_median(), but use several threads (see apply_parallel)
+void rolling_median_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_median()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_median, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_sd(), but use several threads (see apply_parallel)
+void rolling_sd_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_sd()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_sd, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as rolling_var(), but use several threads (see apply_parallel)
+void rolling_var_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for rolling_var()
+  
+  int interpolated = 0;
+  apply_parallel(rolling_var, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+/****************** END: Multi-threaded interface ****************/
+
+
+/******************* Streaming interface ********************/
+
+// State of a rolling operator that is updated one observation at a time
+struct rolling_stream {
+  int op;                 // which rolling operator, e.g. ROLLING_SUM
+  double width_before;    // (non-negative) width of rolling window before the most recent observation
+  double m;               // which moment to calculate (only used for ROLLING_CENTRAL_MOMENT)
+  obs_ring window;        // observations in the current time window
+  obs_ring extremes;      // monotonic deque of candidate extreme values (only used for ROLLING_MAX and ROLLING_MIN)
+  order_stat_tree tree;   // values in the current time window (only used for ROLLING_MEDIAN)
+  moment_sums moments;    // running moments (only used for ROLLING_SD, ROLLING_VAR and integer central moments)
+  double roll_sum;        // rolling sum of values
+  double comp;            // accumulated numeric error of 'roll_sum' (only used for ROLLING_SUM_STABLE)
+  scaled_double back_product;   // product of non-zero values of back part (see rolling_stream_evict)
+  scaled_double *front_product; // products of non-zero values of front part (only used for ROLLING_PRODUCT)
+  int front_capacity;     // length of 'front_product'
+  int num_front;          // number of observations in front part, i.e. at the start of 'window'
+  int num_zeros;          // number of zeros in current time window
+};
+
+
+// Create the state of a rolling operator that is updated one observation at a time (NULL if out of memory)
+// -) the window is the half-open interval (t - width_before, t], where t is the most recent observation time
+rolling_stream *rolling_stream_new(const int *op, const double *width_before)
+{
+  // op           ... which rolling operator, e.g. ROLLING_SUM
+  // width_before ... (non-negative) width of rolling window before most recent observation time
+  
+  rolling_stream *stream = malloc(sizeof(rolling_stream));
+  if (stream == NULL)
+    return NULL;
+  
+  stream->op = *op;
+  stream->width_before = *width_before;
+  stream->m = 2;
+  obs_ring_init(&stream->window);
+  obs_ring_init(&stream->extremes);
+  ost_init(&stream->tree);
+  stream->roll_sum = stream->comp = 0;
+  stream->back_product = scaled_normalize(1, 0);
+  stream->front_product = NULL;
+  stream->front_capacity = stream->num_front = 0;
+  stream->num_zeros = 0;
+  moments_init(&stream->moments, 2);
+  return stream;
+}
+
+
+// Same as rolling_stream_new(ROLLING_CENTRAL_MOMENT, width_before), but for an arbitrary moment
+rolling_stream *rolling_central_moment_stream_new(const double *width_before, const double *m)
+{
+  // width_before ... (non-negative) width of rolling window before most recent observation time
+  // m            ... which moment to calculate (non-negative number)
+  
+  int op = ROLLING_CENTRAL_MOMENT;
+  rolling_stream *stream = rolling_stream_new(&op, width_before);
+  if (stream != NULL) {
+    stream->m = *m;
+    if ((*m == 3) || (*m == 4))
+      moments_init(&stream->moments, (int) *m);
+  }
+  return stream;
+}
+
+
+void rolling_stream_free(rolling_stream *stream)
+{
+  if (stream == NULL)
+    return;
+  obs_ring_free(&stream->window);
+  obs_ring_free(&stream->extremes);
+  ost_free(&stream->tree);
+  free(stream->front_product);
+  free(stream);
+}
+
+
+// Calculate the m-th central moment of the values in the current time window
+static double rolling_stream_central_moment(const rolling_stream *stream, double m)
+{
+  const obs_ring *window = &stream->window;
+  double mean, tmp = 0;
+  
+  // Integer moments of order 2-4 are updated incrementally
+  if ((m == 2) || (m == 3) || (m == 4))
+    return moments_central(&stream->moments, (int) m);
+  
+  // Other moments are calculated from scratch
+  if (window->count < 2)
+    return NAN;
+  mean = stream->roll_sum / window->count;
+  STATS_RESCAN(window->count, 0);
+  for (int j = 0; j < window->count; j++)
+    tmp = tmp + pow(window->values[obs_ring_pos(window, j)] - mean, m);
+  return tmp / (window->count - 1);
+}
+
+
+// Current value of a rolling operator
+double rolling_stream_value(const rolling_stream *stream)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  // stream ... state created by rolling_stream_new()
   
-  int left = 0, right = -1;
+  const obs_ring *window = &stream->window;
+  const obs_ring *extremes = &stream->extremes;
   
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after))
-      right++;
-    
-    // Shrink window on the left
-    while ((left < *n) && (times[left] <= times[i] - *width_before))
-      left++;
-    
-    // Number of observations is equal to length of window
-    values_new[i] = right - left + 1;
+  switch (stream->op) {
+  case ROLLING_NUM_OBS:
+    return window->count;
+  case ROLLING_SUM:
+  case ROLLING_SUM_STABLE:
+    return stream->roll_sum;
+  case ROLLING_PRODUCT:
+    if (stream->num_zeros > 0)
+      return 0;
+    if (stream->num_front == 0)
+      return scaled_to_double(stream->back_product);
+    return scaled_to_double(scaled_multiply(stream->front_product[stream->num_front - 1], stream->back_product));
+  case ROLLING_MEAN:
+    return (window->count > 0) ? stream->roll_sum / window->count : NAN;
+  case ROLLING_MAX:
+    return (extremes->count > 0) ? extremes->values[extremes->head] : -INFINITY;
+  case ROLLING_MIN:
+    return (extremes->count > 0) ? extremes->values[extremes->head] : INFINITY;
+  case ROLLING_MEDIAN:
+    return ost_median(&stream->tree);
+  case ROLLING_SD:
+    return sqrt(rolling_stream_central_moment(stream, 2));
+  case ROLLING_VAR:
+    return rolling_stream_central_moment(stream, 2);
+  case ROLLING_CENTRAL_MOMENT:
+    return rolling_stream_central_moment(stream, stream->m);
+  default:
+    return NAN;
   }
 }
 
 
-// Rolling sum of observation values
-void rolling_sum(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+// Add an observation to the time window of a rolling operator (returns 0 on success, -1 if out of memory)
+static int rolling_stream_add(rolling_stream *stream, double time, double value)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  obs_ring *window = &stream->window;
+  obs_ring *extremes = &stream->extremes;
+  int op = stream->op;
   
-  int left = 0, right = -1;
-  double roll_sum = 0;
-  
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after)) {
-      right++;
-      roll_sum = roll_sum + values[right];
+  if (obs_ring_push_back(window, time, value) != 0)
+    return -1;
+  STATS_ADD(advances, 1);
+  if (op == ROLLING_MAX) {
+    while ((extremes->count > 0) && (extremes->values[obs_ring_pos(extremes, extremes->count - 1)] <= value))
+      obs_ring_pop_back(extremes);
+    if (obs_ring_push_back(extremes, time, value) != 0) {
+      obs_ring_pop_back(window);
+      return -1;
     }
-    
-    // Shrink window on the left
-    while ((left < *n) && (times[left] <= times[i] - *width_before)) {
-      roll_sum = roll_sum - values[left];
-      left++;
+  } else if (op == ROLLING_MIN) {
+    while ((extremes->count > 0) && (extremes->values[obs_ring_pos(extremes, extremes->count - 1)] >= value))
+      obs_ring_pop_back(extremes);
+    if (obs_ring_push_back(extremes, time, value) != 0) {
+      obs_ring_pop_back(window);
+      return -1;
     }
-    
-    // Update rolling sum
-    values_new[i] = roll_sum;
+  } else if (op == ROLLING_MEDIAN) {
+    if (ost_insert(&stream->tree, value) != 0) {
+      obs_ring_pop_back(window);
+      return -1;
+    }
+  } else if (op == ROLLING_SUM_STABLE)
+    compensated_addition(&stream->roll_sum, value, &stream->comp);
+  else if (op == ROLLING_PRODUCT) {
+    // Reserve space for turning the whole time window into the front part (see rolling_stream_evict)
+    scaled_double *front = front_reserve(stream->front_product, &stream->front_capacity, window->count,
+      sizeof(scaled_double));
+    if (front == NULL) {
+      obs_ring_pop_back(window);
+      return -1;
+    }
+    stream->front_product = front;
+    if (value == 0)
+      stream->num_zeros++;
+    else
+      stream->back_product = scaled_multiply(stream->back_product, scaled_normalize(value, 0));
+  } else {
+    stream->roll_sum = stream->roll_sum + value;
+    if ((op == ROLLING_SD) || (op == ROLLING_VAR) || (op == ROLLING_CENTRAL_MOMENT))
+      moments_add(&stream->moments, value);
   }
+  return 0;
 }
 
 
-// Same as rolling_sum, but use Kahan (1965) summation algorithm to reduce numerical error
-void rolling_sum_stable(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+/*
+Remove all observations with time <= t_left_new from the time window of a rolling operator
+-) for ROLLING_PRODUCT, the values are never divided out, but aggregated via sliding window aggregation (see
+   sliding_aggregate): the first num_front observations of 'window' form the front part, and the product of
+   the non-zero values starting at the j-th observation of 'window' is stored in front_product[num_front - 1 - j]
+*/
+static void rolling_stream_evict(rolling_stream *stream, double t_left_new)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
-  
-  int left = 0, right = -1;
-  double roll_sum = 0, comp = 0;
+  obs_ring *window = &stream->window;
+  obs_ring *extremes = &stream->extremes;
+  int op = stream->op;
   
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after)) {
-      right++;
-      compensated_addition(&roll_sum, values[right], &comp);
-    }
-    
-    // Shrink window on the left
-    while ((left < *n) && (times[left] <= times[i] - *width_before)) {
-      compensated_addition(&roll_sum, -values[left], &comp);
-      left++;
+  while ((window->count > 0) && (window->times[window->head] <= t_left_new)) {
+    double value_old = window->values[window->head];
+    if (op == ROLLING_MEDIAN)
+      ost_remove(&stream->tree, value_old);
+    else if (op == ROLLING_SUM_STABLE)
+      compensated_addition(&stream->roll_sum, -value_old, &stream->comp);
+    else if (op == ROLLING_PRODUCT) {
+      // Turn back part into front part if the front part is empty
+      if (stream->num_front == 0) {
+        scaled_double aggregate = scaled_normalize(1, 0);
+        STATS_RESCAN(window->count, 1);
+        for (int j = window->count - 1; j >= 0; j--) {
+          double value = window->values[obs_ring_pos(window, j)];
+          if (value != 0)
+            aggregate = scaled_multiply(scaled_normalize(value, 0), aggregate);
+          stream->front_product[window->count - 1 - j] = aggregate;
+        }
+        stream->num_front = window->count;
+        stream->back_product = scaled_normalize(1, 0);
+      }
+      stream->num_front--;
+      if (value_old == 0)
+        stream->num_zeros--;
+    } else if ((op != ROLLING_MAX) && (op != ROLLING_MIN)) {
+      stream->roll_sum = stream->roll_sum - value_old;
+      if ((op == ROLLING_SD) || (op == ROLLING_VAR) || (op == ROLLING_CENTRAL_MOMENT))
+        moments_remove(&stream->moments, value_old);
     }
-    
-    // Update rolling sum
-    values_new[i] = roll_sum;
+    obs_ring_pop_front(window);
+    STATS_ADD(advances, 1);
+  }
+  while ((extremes->count > 0) && (extremes->times[extremes->head] <= t_left_new))
+    obs_ring_pop_front(extremes);
+  STATS_MAX(peak_occupancy, window->count);
+  if (moments_need_rebuild(&stream->moments)) {
+    STATS_RESCAN(window->count, 1);
+    moments_init(&stream->moments, stream->moments.order);
+    for (int j = 0; j < window->count; j++)
+      moments_add(&stream->moments, window->values[obs_ring_pos(window, j)]);
   }
 }
 
 
-
-// Rolling product of observation values
-void rolling_product(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+/*
+Add an observation to a rolling operator and return the updated value
+-) amortized O(1) time per observation, except O(log N) for ROLLING_MEDIAN and O(N) for non-integer
+   central moments, where N is the number of observations in the time window
+-) the result is the same as the one of the corresponding array-based function with width_after = 0, except
+   that for observations with identical times, only the last one sees all of them in its time window (and
+   its value may differ in the last digits, because the rolling sums are updated in a different order)
+-) returns NAN and leaves the state unchanged if out of memory
+*/
+double rolling_stream_push(rolling_stream *stream, const double *time, const double *value)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  // stream ... state created by rolling_stream_new()
+  // time   ... observation time (not smaller than time of previous observation)
+  // value  ... observation value
   
-  int left = 0, right = -1, most_recent_zero = -1;
-  double roll_product = 1;
+  double value_new = NAN;
   
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after)) {
-      right++;
-      roll_product = roll_product * values[right];
-      
-      // Save position of most recent zero
-      if ((values[right] > -1e-10) && (values[right] < 1e-10))
-        most_recent_zero = right;
-    }
-    
-    // Shrink window on the left
-    while ((left < *n) && (times[left] <= times[i] - *width_before)) {
-      // Don't need to update rolling product if zero drops out, because calculated from scratch below
-      if ((values[left] < -1e-10) || (values[left] > 1e-10))
-        roll_product = roll_product / values[left];
-      left++;
-    }
-    
-    // Update rolling product
-    // -) need to calculate from scratch in case a zero dropped out of the window
-    if ((roll_product == 0) && (most_recent_zero < left)) {
-      roll_product = 1;
-      for (int pos=left; pos <= right; pos++)
-        roll_product = roll_product * values[pos];
-    }
-    values_new[i] = roll_product;
+  STATS_BEGIN();
+  if (rolling_stream_add(stream, *time, *value) == 0) {
+    rolling_stream_evict(stream, *time - stream->width_before);
+    value_new = rolling_stream_value(stream);
   }
+  STATS_END();
+  return value_new;
 }
 
+/****************** END: Streaming interface ****************/
 
-// Rolling average of observation values
-void rolling_mean(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+
+/******************* Chunked interface ********************/
+
+// State of a rolling operator that processes a long time series in consecutive chunks, see rolling_chunked_push()
+struct rolling_chunked {
+  int op;                 // which rolling operator, e.g. ROLLING_SUM
+  double m;               // which moment to calculate (only used for ROLLING_CENTRAL_MOMENT)
+  rolling_state state;    // loop-carried state, with positions relative to the buffer
+  double *values;         // buffer of the observations that are needed for the remaining output values
+  double *times;
+  double *out;            // output values for the observations in the buffer
+  int count;              // number of observations in buffer
+  int capacity;           // length of buffer arrays
+  int next;               // position in buffer of first observation without output value
+  long long num_removed;  // number of observations removed from the buffer (i.e. position of buffer start)
+};
+
+
+// Create the state of a rolling operator that processes a time series in chunks (NULL if out of memory)
+rolling_chunked *rolling_chunked_new(const int *op, const double *width_before, const double *width_after)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
+  // op           ... which rolling operator, e.g. ROLLING_SUM
   // width_before ... (non-negative) width of rolling window before t_i
   // width_after  ... (non-negative) width of rolling window after t_i
   
-  int left = 0, right = -1;
-  double roll_sum = 0;
+  rolling_chunked *chunked = malloc(sizeof(rolling_chunked));
+  if (chunked == NULL)
+    return NULL;
   
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after)) {
-      right++;
-      roll_sum = roll_sum + values[right];
-    }
-    
-    // Shrink window on the left to get half-open interval
-    while ((left < *n) && (times[left] <= times[i] - *width_before)) {
-      roll_sum = roll_sum - values[left];
-      left++;
-    }
-    
-    // Calculate mean of values in rolling window
-    if (left <= right)  // non-empty window
-      values_new[i] = roll_sum / (right - left + 1);
-    else                // empty window
-      values_new[i] = NAN;
-  }
+  chunked->op = *op;
+  chunked->m = 2;
+  chunked->state = rolling_state_init(bounds_from_times(NULL, 0, *width_before, *width_after));
+  chunked->values = chunked->times = chunked->out = NULL;
+  chunked->count = chunked->capacity = chunked->next = 0;
+  chunked->num_removed = 0;
+  return chunked;
 }
 
 
-// Rolling maximum of observation values
-void rolling_max(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+// Same as rolling_chunked_new(ROLLING_CENTRAL_MOMENT, width_before, width_after), but for an arbitrary moment
+rolling_chunked *rolling_central_moment_chunked_new(const double *width_before, const double *width_after,
+  const double *m)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times matching time series values
-  // n            ... length of 'values'
-  // values_new   ... array (of same length as 'values') used to store output
   // width_before ... (non-negative) width of rolling window before t_i
   // width_after  ... (non-negative) width of rolling window after t_i
+  // m            ... which moment to calculate (non-negative number)
   
-  int j, left = 0, right = -1, max_pos = 0;
-  
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after)) {
-      right++;
-      if (values[right] >= values[max_pos])
-        max_pos = right;
-    }
-    
-    // Shrink window on the left to get half-open interval
-    while ((left < *n) && (times[left] <= times[i] - *width_before))
-      left++;      
-    
-    // Recalculate position of maximum if old maximum dropped out
-    // Inline functionality of max_index() to avoid function call overhead
-    if (max_pos < left) {
-      max_pos = left;
-      for (j = left+1; j <= right; j++)
-        if (values[j] >= values[max_pos])
-          max_pos = j;
-    }
-    
-    // Save maximum in current time window
-    if (left <= right)  // non-empty window
-      values_new[i] = values[max_pos];
-    else                // empty window
-      values_new[i] = -INFINITY;
+  int op = ROLLING_CENTRAL_MOMENT;
+  rolling_chunked *chunked = rolling_chunked_new(&op, width_before, width_after);
+  if (chunked != NULL) {
+    chunked->m = *m;
+    if ((*m == 3) || (*m == 4))
+      moments_init(&chunked->state.moments, (int) *m);
   }
+  return chunked;
 }
 
 
-// Rolling minimum of observation values
-void rolling_min(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+void rolling_chunked_free(rolling_chunked *chunked)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times matching time series values
-  // n            ... length of 'values'
-  // values_new   ... array (of same length as 'values') used to store output
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  if (chunked == NULL)
+    return;
+  free(chunked->values);
+  free(chunked->times);
+  free(chunked->out);
+  free(chunked->state.front);
+  free(chunked->state.front_product);
+  free(chunked->state.deque);
+  ost_free(&chunked->state.tree);
+  free(chunked);
+}
+
+
+// Number of observations that have been pushed, but whose output value has not been returned yet
+int rolling_chunked_pending(const rolling_chunked *chunked)
+{
+  return chunked->count - chunked->next;
+}
+
+
+/*
+Remove the observations from the buffer that are no longer needed, i.e. that are before the current time window
+and already have an output value
+-) only done if at least as many observations are removed as are kept, so that the cost of moving the kept
+   observations is O(1) amortized per observation
+*/
+static void rolling_chunked_compact(rolling_chunked *chunked)
+{
+  rolling_state *state = &chunked->state;
+  int shift = (chunked->next < state->bounds.left) ? chunked->next : state->bounds.left;
+  int keep = chunked->count - shift;
   
-  int j, left = 0, right = -1, min_pos = 0;
+  if ((shift == 0) || (shift < keep))
+    return;
   
-  for (int i = 0; i < *n; i++) {   
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after)) {
-      right++;
-      if (values[right] <= values[min_pos])
-        min_pos = right;
-    }
-    
-    // Shrink window on the left to get half-open interval
-    while ((left < *n) && (times[left] <= times[i] - *width_before))
-      left++;      
-    
-    // Recalculate position of minimum if old minimum dropped out
-    // Inline the calculation of the minimum position to avoid any function call overhead
-    if (min_pos < left) {
-      min_pos = left;
-      for (j = left+1; j <= right; j++)
-        if (values[j] <= values[min_pos])
-          min_pos = j;
-    }
-    
-    // Save minium in current time window
-    if (left <= right)  // non-empty window
-      values_new[i] = values[min_pos];
-    else                // empty window
-      values_new[i] = INFINITY;
+  memmove(chunked->values, chunked->values + shift, keep * sizeof(double));
+  memmove(chunked->times, chunked->times + shift, keep * sizeof(double));
+  
+  // Candidate extrema, which are all in the current time window
+  if (state->deque != NULL) {
+    for (int j = state->head; j < state->tail; j++)
+      state->deque[j - state->head] = state->deque[j] - shift;
+    state->tail -= state->head;
+    state->head = 0;
   }
+  
+  // Positions (which may become negative for positions that are not used by the operator)
+  state->bounds.left -= shift;
+  state->bounds.right -= shift;
+  state->bounds_rescan.left -= shift;
+  state->bounds_rescan.right -= shift;
+  state->left -= shift;
+  state->right -= shift;
+  state->mid -= shift;
+  chunked->next -= shift;
+  chunked->count = keep;
+  chunked->num_removed += shift;
 }
 
 
-// Rolling median
-void rolling_median(const double values[], const double times[], const int *n, double values_new[], 
-  const double *width_before, const double *width_after)
+// Make room for at least 'capacity' observations in the buffer (returns 0 on success, -1 if out of memory)
+static int rolling_chunked_reserve(rolling_chunked *chunked, int capacity)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times matching time series values
-  // n            ... length of 'values'
-  // values_new   ... array (of same length as 'values') used to store output
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  rolling_state *state = &chunked->state;
+  int op = chunked->op;
+  double *values, *times, *out;
+  
+  if (capacity <= chunked->capacity)
+    return 0;
+  if (capacity < 2 * chunked->capacity)
+    capacity = 2 * chunked->capacity;
   
-  int j, window_length, left = 0, right = -1;
-  double values_tmp[*n];      // temporary array for median(), which shuffles the input data 
+  // Buffer arrays (the old pointers remain valid if realloc fails)
+  if ((values = realloc(chunked->values, capacity * sizeof(double))) == NULL)
+    return -1;
+  chunked->values = values;
+  if ((times = realloc(chunked->times, capacity * sizeof(double))) == NULL)
+    return -1;
+  chunked->times = times;
+  if ((out = realloc(chunked->out, capacity * sizeof(double))) == NULL)
+    return -1;
+  chunked->out = out;
+  
+  // Arrays of operator state (the arrays of sliding window aggregation are grown by the kernels)
+  if ((op == ROLLING_MAX) || (op == ROLLING_MIN)) {
+    int *deque = realloc(state->deque, capacity * sizeof(int));
+    if (deque == NULL)
+      return -1;
+    state->deque = deque;
+  }
+  chunked->capacity = capacity;
+  return 0;
+}
 
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after))
-      right++;
-    
-    // Shrink window on the left end
-    while ((left < *n) && (times[left] <= times[i] - *width_before))
-      left++;
-    
-    // Copy data in rolling window to temporary array, then calculate the median
-    window_length = right - left + 1;
-    for (j = 0; j < window_length; j++)
-      values_tmp[j] = values[left + j];
-    values_new[i] = median(values_tmp, window_length);
+
+// Calculate the output values of the observations next, ..., end - 1 in the buffer, and copy them to 'values_new'
+static int rolling_chunked_run(rolling_chunked *chunked, int end, double values_new[], int *n_new)
+{
+  rolling_state *state = &chunked->state;
+  int start = chunked->next, status = 0;
+  double *out = chunked->out;
+  
+  *n_new = 0;
+  if (end <= start)
+    return 0;
+  state->bounds.times = state->bounds_rescan.times = chunked->times;
+  state->bounds.n = state->bounds_rescan.n = chunked->count;
+  
+  switch (chunked->op) {
+  case ROLLING_NUM_OBS:
+    rolling_num_obs_kernel(state, out, start, end);
+    break;
+  case ROLLING_SUM:
+  case ROLLING_MEAN:
+    status = sliding_aggregate(chunked->values, state, out, sum_combine, 0, chunked->op == ROLLING_MEAN, start,
+      end);
+    break;
+  case ROLLING_SUM_STABLE:
+    rolling_sum_stable_kernel(chunked->values, state, out, start, end);
+    break;
+  case ROLLING_PRODUCT:
+    status = sliding_product(chunked->values, state, out, start, end);
+    break;
+  case ROLLING_MAX:
+  case ROLLING_MIN:
+    rolling_extremum_kernel(chunked->values, state, out, chunked->op == ROLLING_MAX, start, end);
+    break;
+  case ROLLING_MEDIAN:
+    status = rolling_median_kernel(chunked->values, state, out, start, end);
+    break;
+  case ROLLING_SD:
+  case ROLLING_VAR:
+  case ROLLING_CENTRAL_MOMENT:
+    rolling_central_moment_kernel(chunked->values, state, out, chunked->m, start, end);
+    if (chunked->op == ROLLING_SD) {
+      for (int i = start; i < end; i++)
+        out[i] = sqrt(out[i]);
+    }
+    break;
+  default:
+    for (int i = start; i < end; i++)
+      out[i] = NAN;
   }
+  
+  memcpy(values_new, out + start, (end - start) * sizeof(double));
+  *n_new = end - start;
+  chunked->next = end;
+  return status;
 }
 
 
-// Rolling central moment of observation values
-void rolling_central_moment(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after, const double *m)
+/*
+Add the next chunk of observations of a long time series to a rolling operator, and return the output values of
+all observations whose time window is complete
+-) the time window of observation i is (t_i - width_before, t_i + width_after], so the output value of an
+   observation is only known once an observation with a time after t_i + width_after has been pushed (or after
+   rolling_chunked_finish() has been called)
+-) the concatenated output values of all calls to rolling_chunked_push() and rolling_chunked_finish() are
+   exactly the same as the output of the corresponding array-based function (e.g. rolling_sum) for the whole
+   time series, no matter how the time series is split into chunks
+-) only the observations of the current time window (including the ones after t_i needed for width_after) are
+   kept between calls, so the memory usage is bounded by a small multiple of the chunk size plus the largest
+   number of observations in a time window, and the total number of observations is not limited by the range
+   of an int
+-) returns 0 on success, and -1 if out of memory. Output values that could not be calculated are set to NAN
+   (currently only possible for ROLLING_MEDIAN), and observations that could not be added to the buffer are
+   ignored.
+*/
+int rolling_chunked_push(rolling_chunked *chunked, const double values[], const double times[], const int *n,
+  double values_new[], int *n_new)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
-  // m            ... which moment to calculate (non-negative number)
+  // chunked    ... state created by rolling_chunked_new()
+  // values     ... array of time series values of chunk
+  // times      ... array of observation times of chunk (not smaller than times of previous chunks)
+  // n          ... number of observations in chunk, i.e. length of 'values' and 'times'
+  // values_new ... array of length *n + rolling_chunked_pending(chunked) to store the output values
+  // n_new      ... number of output values stored in 'values_new'
   
-  int left = 0, right = -1;
-  double tmp;
+  double *buffer_times, width_after = chunked->state.bounds.width_after;
+  int low, high;
   
-  // Calculate the rolling first moment
-  double *rolling_1st_moment = malloc(*n * sizeof(double));
-  rolling_mean(values, times, n, rolling_1st_moment, width_before, width_after);
+  *n_new = 0;
+  rolling_chunked_compact(chunked);
+  if (rolling_chunked_reserve(chunked, chunked->count + *n) != 0)
+    return -1;
+  memcpy(chunked->values + chunked->count, values, *n * sizeof(double));
+  memcpy(chunked->times + chunked->count, times, *n * sizeof(double));
+  chunked->count += *n;
+  if (chunked->count == 0)
+    return 0;
   
-  // Calculate m-th central moment
-  for (int i = 0; i < *n; i++) {
-    // Expand window on the right
-    while ((right < *n - 1) && (times[right + 1] <= times[i] + *width_after))
-      right++;
-    
-    // Shrink window on the left
-    while ((left < *n) && (times[left] <= times[i] - *width_before))
-      left++;
-    
-    // Calculate m-th central moment in current time window
-    if (left < right) {   // two or more observations in time window
-      tmp = 0;
-      for (int pos = left; pos <= right; pos++)
-        tmp = tmp + pow(values[pos] - rolling_1st_moment[i], *m);
-      values_new[i] = tmp / (right - left);
-    } else
-      values_new[i] = NAN;
+  // Find the first observation whose time window might include future observations, i.e. with
+  // t_last <= t_i + width_after, using the same comparison as when expanding the time window
+  buffer_times = chunked->times;
+  low = chunked->next;
+  high = chunked->count - 1;   // always satisfies the condition
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (buffer_times[chunked->count - 1] <= buffer_times[mid] + width_after)
+      high = mid;
+    else
+      low = mid + 1;
   }
-  free(rolling_1st_moment);
+  return rolling_chunked_run(chunked, low, values_new, n_new);
+}
+
+
+// Return the output values of all remaining observations, after the last chunk has been pushed
+// (returns 0 on success, and -1 if out of memory)
+int rolling_chunked_finish(rolling_chunked *chunked, double values_new[], int *n_new)
+{
+  // chunked    ... state created by rolling_chunked_new()
+  // values_new ... array of length rolling_chunked_pending(chunked) to store the output values
+  // n_new      ... number of output values stored in 'values_new'
+  
+  return rolling_chunked_run(chunked, chunked->count, values_new, n_new);
 }
 
+/****************** END: Chunked interface ****************/
 
 
-// Rolling standard deviation of observation values
-void rolling_sd(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+/******************* Evaluation at arbitrary times ********************/
+
+// Return the position of the first observation time, starting at position 'start', that is larger than 'time'
+// (or n if there is none), using galloping search, i.e. O(log d) time, where d is the distance moved
+static inline int gallop_after(const double times[], int start, int n, double time)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  int low = start, high, step = 1;
   
-  double moment = 2;
-  rolling_central_moment(values, times, n, values_new, width_before, width_after, &moment);
-  for (int i = 0; i < *n; i++)
-    values_new[i] = sqrt(values_new[i]);
+  // Find a range [low, high) containing the result by doubling the step size
+  while ((low + step < n) && (times[low + step] <= time)) {
+    low = low + step;
+    step = 2 * step;
+  }
+  high = (low + step < n) ? low + step : n;
+  
+  // Binary search, with loop invariant: times[low - 1] <= time < times[high]
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (times[mid] <= time)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
 }
 
 
-// Rolling variance of observation values
-void rolling_var(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+/*
+Calculate a rolling operator only at the output times 'times_out', which need not coincide with the observation
+times
+-) the time window around each output time s is (s - width_before, s + width_after], like for the array-based
+   functions
+-) the observations in the time window are kept in the same state as for the streaming interface, and
+   observations that lie entirely between two consecutive time windows are skipped via galloping search, so
+   that the run-time is O(number of output times * log(gap) + number of observations that enter the window)
+   (times O(log N) for ROLLING_MEDIAN)
+-) the result at an observation time equals the one of the corresponding array-based function, up to rounding
+   errors in the rolling sums
+-) returns NAN for all output times if out of memory
+*/
+void rolling_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const int *op, const double *width_before, const double *width_after)
 {
   // values       ... array of time series values
   // times        ... array of observation times
   // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  // times_out    ... array of output times (not decreasing)
+  // n_out        ... number of output times, i.e. length of 'times_out'
+  // values_new   ... array of length *n_out to store output values
+  // op           ... which rolling operator, e.g. ROLLING_SUM
+  // width_before ... (non-negative) width of rolling window before each output time
+  // width_after  ... (non-negative) width of rolling window after each output time
   
-  double moment = 2;
-  rolling_central_moment(values, times, n, values_new, width_before, width_after, &moment);
+  int next = 0;   // next observation to add to the time window
+  rolling_stream *stream = rolling_stream_new(op, width_before);
+  
+  for (int k = 0; k < *n_out; k++) {
+    double t_left_new = times_out[k] - *width_before, t_right_new = times_out[k] + *width_after;
+    
+    // Skip observations that are already outside of the time window on the left
+    if ((next < *n) && (times[next] <= t_left_new))
+      next = gallop_after(times, next, *n, t_left_new);
+    
+    // Expand window on the right, and shrink window on the left
+    while ((stream != NULL) && (next < *n) && (times[next] <= t_right_new)) {
+      if (rolling_stream_add(stream, times[next], values[next]) != 0) {
+        rolling_stream_free(stream);
+        stream = NULL;
+      }
+      next++;
+    }
+    if (stream == NULL) {
+      values_new[k] = NAN;
+      continue;
+    }
+    rolling_stream_evict(stream, t_left_new);
+    
+    // Save value for current time window
+    values_new[k] = rolling_stream_value(stream);
+  }
+  rolling_stream_free(stream);
 }
+
+/****************** END: Evaluation at arbitrary times ****************/
@@ -5,6 +5,32 @@
 #ifndef _rolling_h
 #define _rolling_h
 
+// Rolling operators, used to select the operator of the streaming interface, or the statistics of rolling_stats()
+enum {
+  ROLLING_NUM_OBS,
+  ROLLING_SUM,
+  ROLLING_SUM_STABLE,
+  ROLLING_PRODUCT,
+  ROLLING_MEAN,
+  ROLLING_MAX,
+  ROLLING_MIN,
+  ROLLING_MEDIAN,
+  ROLLING_SD,
+  ROLLING_VAR,
+  ROLLING_CENTRAL_MOMENT
+};
+
+// Associative operations for rolling_aggregate() and rolling_aggregate_generic()
+typedef double (*rolling_combine)(double a, double b);
+typedef void (*rolling_combine_generic)(void *result, const void *a, const void *b, void *context);
+
+void rolling_aggregate(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, rolling_combine combine, const double *identity);
+
+int rolling_aggregate_generic(const void *values, const double times[], const int *n, void *values_new,
+  const int *size, const double *width_before, const double *width_after, rolling_combine_generic combine,
+  const void *identity, void *context);
+
 void rolling_central_moment(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after, const double *m);
 
@@ -14,6 +40,9 @@ void rolling_max(const double values[], const double times[], const int *n, doub
 void rolling_mean(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
+void rolling_mean_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths);
+
 void rolling_median(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
@@ -26,16 +55,131 @@ void rolling_num_obs(const double values[], const double times[], const int *n,
 void rolling_product(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
+void rolling_quantile(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const double probs[], const int *num_probs);
+
 void rolling_sd(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
+void rolling_stats(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *stats);
+
 void rolling_sum(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
+void rolling_sum_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths);
+
 void rolling_sum_stable(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
 void rolling_var(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
+
+// Multi-threaded versions of the above functions (via OpenMP if enabled at compile time)
+void rolling_num_obs_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_sum_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_sum_stable_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_product_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_mean_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_max_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_min_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_median_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_sd_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void rolling_var_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+
+// Evaluate a rolling operator only at the output times 'times_out' (see rolling_at() for details)
+void rolling_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const int *op, const double *width_before, const double *width_after);
+
+
+/*
+Window plans: the first and last observation in each rolling time window, which can be calculated once and
+reused for several operators and value columns with the same observation times (see rolling_plan)
+-) the functions below are the same as the functions without "_plan", but use the time windows from the plan
+   (and rolling_num_obs_plan() has no argument for the values, which it does not need)
+*/
+typedef void (*rolling_plan_operator)(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+
+void rolling_plan(const double times[], const int *n, const double *width_before, const double *width_after,
+  int lefts[], int rights[]);
+
+void rolling_central_moment_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[], const double *m);
+void rolling_num_obs_plan(const int lefts[], const int rights[], const int *n, double values_new[]);
+void rolling_sum_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_sum_stable_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_product_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_mean_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_max_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_min_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_median_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_sd_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+void rolling_var_plan(const double values[], const int lefts[], const int rights[], const int *n,
+  double values_new[]);
+
+
+/*
+Streaming interface: update a rolling operator one observation at a time
+-) the state is stored in a growable ring buffer, so memory usage is bounded by the largest number of
+   observations in a time window, instead of by the length of the time series
+-) see rolling_stream_push() for details
+*/
+typedef struct rolling_stream rolling_stream;
+
+rolling_stream *rolling_stream_new(const int *op, const double *width_before);
+rolling_stream *rolling_central_moment_stream_new(const double *width_before, const double *m);
+void rolling_stream_free(rolling_stream *stream);
+
+double rolling_stream_push(rolling_stream *stream, const double *time, const double *value);
+double rolling_stream_value(const rolling_stream *stream);
+
+
+/*
+Chunked interface: process a time series that does not fit into memory in consecutive chunks
+-) only the observations of the current time window are kept between chunks, and the output is exactly the same
+   as the one of the corresponding array-based function for the whole time series
+-) see rolling_chunked_push() for details
+*/
+typedef struct rolling_chunked rolling_chunked;
+
+rolling_chunked *rolling_chunked_new(const int *op, const double *width_before, const double *width_after);
+rolling_chunked *rolling_central_moment_chunked_new(const double *width_before, const double *width_after,
+  const double *m);
+void rolling_chunked_free(rolling_chunked *chunked);
+int rolling_chunked_push(rolling_chunked *chunked, const double values[], const double times[], const int *n,
+  double values_new[], int *n_new);
+int rolling_chunked_finish(rolling_chunked *chunked, double values_new[], int *n_new);
+int rolling_chunked_pending(const rolling_chunked *chunked);
+
 #endif
@@ -1,7 +1,16 @@
 // Copyright: 2012-2018 by Andreas Eckner
 // License: GPL-2 | GPL-3
 
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parallel.h"
 #include "sma.h"
+#include "stats.h"
+
+// Interpolation schemes
+enum {SMA_LAST, SMA_NEXT, SMA_LINEAR};
 
 #ifndef MAX
 #  define MAX(a,b) (((a) > (b)) ? (a) : (b))
@@ -42,47 +51,196 @@ static inline double trapezoid_right(double x1, double x2, double x3, double y1,
 }
 
 
-// SMA_last(X, width)
-void sma_last(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+// Linear interpolation of (x1, y1) and (x2, y2) evaluated at x
+static inline double interpolate_linear(double x1, double x2, double y1, double y2, double x)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  if (x1 == x2)
+    return y2;
+  double w = (x2 - x) / (x2 - x1);
+  return y1 * w + y2 * (1 - w);
+}
+
+
+// Return the position of the first observation time, starting at position 'start', that is not smaller than
+// 'time' (or n if there is none), using galloping search, i.e. O(log d) time, where d is the distance moved
+static inline int gallop_not_before(const double times[], int start, int n, double time)
+{
+  int low = start, high, step = 1;
+  
+  // Find a range [low, high) containing the result by doubling the step size
+  while ((low + step < n) && (times[low + step] < time)) {
+    low = low + step;
+    step = 2 * step;
+  }
+  high = (low + step < n) ? low + step : n;
   
-  int left = 0, right = 0;
-  double t_left_new, t_right_new, roll_area, left_area, right_area = 0;
+  // Binary search, with loop invariant: times[low - 1] < time <= times[high]
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (times[mid] < time)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+
+// Return the (positive) spacing of the observation times if it is the same for all observations, and zero
+// otherwise
+// -) the comparison is exact, and irregularly spaced observation times are usually detected after a few steps
+static inline double regular_spacing(const double times[], int n)
+{
+  double spacing;
+  
+  if (n < 2)
+    return 0;
+  spacing = times[1] - times[0];
+  if (!(spacing > 0))
+    return 0;
+  for (int i = 2; i < n; i++)
+    if (times[i] - times[i-1] != spacing)
+      return 0;
+  return spacing;
+}
+
+
+/*
+SMA for regularly spaced observation times, i.e. with times[i] - times[i-1] equal to the same 'spacing' for all i
+(see sma_last_regular(), sma_next_regular() and sma_linear_regular())
+-) the time window of observation i consists of observations i - num_before, ..., i + num_after (truncated to
+   0, ..., n - 1), so there are no while-loops over the observation times, and the sum of the values in the
+   time window is updated with a single addition per observation
+-) the area of the truncated intervals at both ends of the time window is calculated with the same formulas as in
+   the general case, but the summation order of the full intervals is different, so the result agrees with the
+   one of the general case only up to rounding errors. This is also true if, due to rounding, the window
+   boundary t_i - width_before (or t_i + width_after) is slightly on the other side of an observation time than
+   in the general case, because the SMA is a continuous function of the window boundaries.
+-) returns 0 on success, and -1 (without changing 'values_new') if the observation times are not regularly
+   spaced
+*/
+static inline int sma_regular(int scheme, const double values[], const double times[], int n, double values_new[],
+  double width_before, double width_after)
+{
+  // scheme ... interpolation scheme (SMA_LAST, SMA_NEXT or SMA_LINEAR)
+  
+  int left, right, left_old, right_old, num_before, num_after;
+  double spacing, sum = 0, t_left_new, t_right_new, full_area, left_area, right_area;
+  
+  spacing = regular_spacing(times, n);
+  if (spacing == 0)
+    return -1;
+  
+  // Number of observations in the time window before and after t_i, correcting the quotients for rounding
+  // errors by comparing with the observation times at the end (before) and the start (after) of the time series
+  num_before = (width_before / spacing < n - 1) ? (int) (width_before / spacing) : n - 1;
+  while ((num_before < n - 1) && (times[n - num_before - 2] >= times[n-1] - width_before))
+    num_before++;
+  while ((num_before > 0) && (times[n - 1 - num_before] < times[n-1] - width_before))
+    num_before--;
+  num_after = (width_after / spacing < n - 1) ? (int) (width_after / spacing) : n - 1;
+  while ((num_after < n - 1) && (times[num_after + 1] <= times[0] + width_after))
+    num_after++;
+  while ((num_after > 0) && (times[num_after] > times[0] + width_after))
+    num_after--;
+  
+  // Sum of values[left], ..., values[right - 1] for the time window of the first observation
+  left_old = 0;
+  right_old = MIN(n - 1, num_after);
+  for (int j = left_old; j < right_old; j++)
+    sum += values[j];
+  
+  values_new[0] = values[0];
+  for (int i = 1; i < n; i++) {
+    // Move time window by (at most) one observation on each end
+    left = MAX(0, i - num_before);
+    right = MIN(n - 1, i + num_after);
+    sum += ((right > right_old) ? values[right - 1] : 0) - ((left > left_old) ? values[left - 1] : 0);
+    left_old = left;
+    right_old = right;
+    
+    // Area of full intervals, and of truncated intervals at left and right end
+    t_left_new = times[i] - width_before;
+    t_right_new = times[i] + width_after;
+    if (scheme == SMA_LAST) {
+      full_area = sum * spacing;
+      left_area = values[MAX(0, left-1)] * (times[left] - t_left_new);
+      right_area = values[right] * (t_right_new - times[right]);
+    } else if (scheme == SMA_NEXT) {
+      full_area = (sum - values[left] + values[right]) * spacing;
+      left_area = values[left] * (times[left] - t_left_new);
+      right_area = values[right] * (t_right_new - times[right]);
+    } else {
+      full_area = (2 * sum - values[left] + values[right]) / 2 * spacing;
+      left_area = trapezoid_left(times[MAX(0, left-1)], t_left_new, times[left],
+        values[MAX(0, left-1)], values[left]);
+      right_area = trapezoid_right(times[right], t_right_new, times[MIN(right+1, n-1)],
+        values[right], values[MIN(right+1, n-1)]);
+    }
+    values_new[i] = (full_area + left_area + right_area) / (width_before + width_after);
+  }
+  
+  return 0;
+}
+
+
+// Loop-carried state of the SMA helpers, which allows to process the observations in consecutive chunks
+typedef struct {
+  int left;              // first observation in current time window
+  int right;             // last observation in current time window
+  double roll_area;      // area under the time series in current time window
+  double left_area;      // truncated area on the left end
+  double right_area;     // truncated area on the right end
+} sma_state;
+
+
+// SMA_last(X, width), with the time windows optionally given by a window plan (see rolling_plan)
+static inline void sma_last_helper(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int lefts[], const int rights[], sma_state *state,
+  int start, int end)
+{
+  // lefts, rights ... window plan, or NULL to calculate the time windows from the observation times
+  // state         ... loop-carried state from processing observations 0, ..., start - 1
+  // start, end    ... process observations start, ..., end - 1
+  
+  int left = state->left, right = state->right;
+  double t_left_new, t_right_new, roll_area = state->roll_area, left_area = state->left_area;
+  double right_area = state->right_area;
   
   // Trivial case
-  if (*n == 0)
+  if (start >= end)
     return;
   
   // Initialize output
-  values_new[0] = values[0];  
-  roll_area = left_area = values[0] * (*width_before + *width_after);
+  if (start == 0) {
+    values_new[0] = values[0];
+    roll_area = left_area = values[0] * (*width_before + *width_after);
+    start = 1;
+  }
   
   // Apply rolling window
-  for (int i = 1; i < *n; i++) {
+  for (int i = start; i < end; i++) {
     // Remove truncated area on left and right end
     roll_area -= (left_area + right_area);
     
     // Expand interval on right end
     t_right_new = times[i] + *width_after;
-    while ((right < *n - 1) && (times[right + 1] <= t_right_new)) {
+    while ((rights != NULL) ? (right < rights[i]) : ((right < *n - 1) && (times[right + 1] <= t_right_new))) {
       right++;
+      STATS_ADD(advances, 1);
       roll_area += values[right - 1] * (times[right] - times[right - 1]);
     }
     
     // Shrink interval on left end
     t_left_new = times[i] - *width_before;
-    while (times[left] < t_left_new) {
+    while (((lefts == NULL) || (left < lefts[i])) && (times[left] < t_left_new)) {
       roll_area -= values[left] * (times[left+1] - times[left]);
-      left++;  
+      left++;
+      STATS_ADD(advances, 1);
     }
     
+    STATS_MAX(peak_occupancy, right - left + 1);
+    
     // Add truncated area on left and right end
     left_area = values[MAX(0, left-1)] * (times[left] - t_left_new);
     right_area = values[right] * (t_right_new - times[right]);
@@ -91,50 +249,63 @@ void sma_last(const double values[], const double times[], const int *n, double
     // Save SMA value for current time window
     values_new[i] = roll_area / (*width_before + *width_after);
   }
+  
+  // Save loop-carried state
+  state->left = left;
+  state->right = right;
+  state->roll_area = roll_area;
+  state->left_area = left_area;
+  state->right_area = right_area;
 }
 
 
-// SMA_next(X, width)
-void sma_next(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+// SMA_next(X, width), with the time windows optionally given by a window plan (see rolling_plan)
+static inline void sma_next_helper(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int lefts[], const int rights[], sma_state *state,
+  int start, int end)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  // lefts, rights ... window plan, or NULL to calculate the time windows from the observation times
+  // state         ... loop-carried state from processing observations 0, ..., start - 1
+  // start, end    ... process observations start, ..., end - 1
   
-  int left = 0, right = 0;
-  double t_left_new, t_right_new, roll_area, left_area, right_area = 0;
+  int left = state->left, right = state->right;
+  double t_left_new, t_right_new, roll_area = state->roll_area, left_area = state->left_area;
+  double right_area = state->right_area;
   
   // Trivial case
-  if (*n == 0)
+  if (start >= end)
     return;
   
   // Initialize output
-  values_new[0] = values[0];  
-  roll_area = left_area = values[0] * (*width_before + *width_after);
+  if (start == 0) {
+    values_new[0] = values[0];
+    roll_area = left_area = values[0] * (*width_before + *width_after);
+    start = 1;
+  }
   
   // Apply rolling window
-  for (int i = 1; i < *n; i++) {
+  for (int i = start; i < end; i++) {
     // Remove truncated area on left and right end
     roll_area -= (left_area + right_area);
     
     // Expand interval on right end
     t_right_new = times[i] + *width_after;
-    while ((right < *n - 1) && (times[right + 1] <= t_right_new)) {
+    while ((rights != NULL) ? (right < rights[i]) : ((right < *n - 1) && (times[right + 1] <= t_right_new))) {
       right++;
+      STATS_ADD(advances, 1);
       roll_area += values[right] * (times[right] - times[right - 1]);
     }
     
     // Shrink interval on left end
     t_left_new = times[i] - *width_before;
-    while (times[left] < t_left_new) {
+    while (((lefts == NULL) || (left < lefts[i])) && (times[left] < t_left_new)) {
       roll_area -= values[left+1] * (times[left+1] - times[left]);
-      left++;  
+      left++;
+      STATS_ADD(advances, 1);
     }
     
+    STATS_MAX(peak_occupancy, right - left + 1);
+    
     // Add truncated area on left and rigth end
     left_area = values[left] * (times[left] - t_left_new);
     right_area = values[right] * (t_right_new - times[right]);
@@ -143,51 +314,64 @@ void sma_next(const double values[], const double times[], const int *n, double
     // Save SMA value for current time window
     values_new[i] = roll_area / (*width_before + *width_after);
   }
+  
+  // Save loop-carried state
+  state->left = left;
+  state->right = right;
+  state->roll_area = roll_area;
+  state->left_area = left_area;
+  state->right_area = right_area;
 }
 
 
-// SMA_linear(X, width)
-void sma_linear(const double values[], const double times[], const int *n, double values_new[],
-  const double *width_before, const double *width_after)
+// SMA_linear(X, width), with the time windows optionally given by a window plan (see rolling_plan)
+static inline void sma_linear_helper(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int lefts[], const int rights[], sma_state *state,
+  int start, int end)
 {
-  // values       ... array of time series values
-  // times        ... array of observation times
-  // n            ... number of observations, i.e. length of 'values' and 'times'
-  // values_new   ... array of length *n to store output time series values
-  // width_before ... (non-negative) width of rolling window before t_i
-  // width_after  ... (non-negative) width of rolling window after t_i
+  // lefts, rights ... window plan, or NULL to calculate the time windows from the observation times
+  // state         ... loop-carried state from processing observations 0, ..., start - 1
+  // start, end    ... process observations start, ..., end - 1
   
-  int left = 0, right = 0;
-  double t_left_new, t_right_new, roll_area, left_area, right_area = 0;
+  int left = state->left, right = state->right;
+  double t_left_new, t_right_new, roll_area = state->roll_area, left_area = state->left_area;
+  double right_area = state->right_area;
   
   // Trivial case
-  if (*n == 0)
+  if (start >= end)
     return;
   
   // Initialize output
-  values_new[0] = values[0];
-  roll_area = left_area = values[0] * (*width_before + *width_after);
+  if (start == 0) {
+    values_new[0] = values[0];
+    roll_area = left_area = values[0] * (*width_before + *width_after);
+    start = 1;
+  }
   
   // Apply rolling window
-  for (int i = 1; i < *n; i++) {   
+  for (int i = start; i < end; i++) {
     // Remove truncated area on left and right end
     roll_area -= (left_area + right_area);
     
     // Expand interval on right end
     t_right_new = times[i] + *width_after;
-    while ((right < *n - 1) && (times[right + 1] <= t_right_new)) {
+    while ((rights != NULL) ? (right < rights[i]) : ((right < *n - 1) && (times[right + 1] <= t_right_new))) {
       right++;
+      STATS_ADD(advances, 1);
       roll_area += (values[right] + values[right - 1])/2 * (times[right] - times[right - 1]);
     }
     
     // Shrink interval on left end
     t_left_new = times[i] - *width_before;
-    while (times[left] < t_left_new) {
+    while (((lefts == NULL) || (left < lefts[i])) && (times[left] < t_left_new)) {
       roll_area -= (values[left] + values[left+1]) / 2 *
         (times[left+1] - times[left]);
-      left++;  
+      left++;
+      STATS_ADD(advances, 1);
     }
     
+    STATS_MAX(peak_occupancy, right - left + 1);
+    
     // Add truncated area on left and right end
     left_area = trapezoid_left(times[MAX(0, left-1)], t_left_new, times[left],
       values[MAX(0, left-1)], values[left]);
@@ -198,4 +382,950 @@ void sma_linear(const double values[], const double times[], const int *n, doubl
     // Save SMA value for current time window
     values_new[i] = roll_area / (*width_before + *width_after);
   }
+  
+  // Save loop-carried state
+  state->left = left;
+  state->right = right;
+  state->roll_area = roll_area;
+  state->left_area = left_area;
+  state->right_area = right_area;
+}
+
+
+// SMA_last(X, width)
+void sma_last(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  sma_last_helper(values, times, n, values_new, width_before, width_after, NULL, NULL, &state, 0, *n);
+  STATS_END();
+}
+
+
+// SMA_next(X, width)
+void sma_next(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  sma_next_helper(values, times, n, values_new, width_before, width_after, NULL, NULL, &state, 0, *n);
+  STATS_END();
 }
+
+
+// SMA_linear(X, width)
+void sma_linear(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  sma_linear_helper(values, times, n, values_new, width_before, width_after, NULL, NULL, &state, 0, *n);
+  STATS_END();
+}
+
+
+// Same as sma_last(), but faster for regularly spaced observation times (see sma_regular), in which case the
+// result agrees with the one of sma_last() only up to rounding errors
+void sma_last_regular(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_last()
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  if (sma_regular(SMA_LAST, values, times, *n, values_new, *width_before, *width_after) != 0)
+    sma_last_helper(values, times, n, values_new, width_before, width_after, NULL, NULL, &state, 0, *n);
+  STATS_END();
+}
+
+
+// Same as sma_next(), but faster for regularly spaced observation times (see sma_regular), in which case the
+// result agrees with the one of sma_next() only up to rounding errors
+void sma_next_regular(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_next()
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  if (sma_regular(SMA_NEXT, values, times, *n, values_new, *width_before, *width_after) != 0)
+    sma_next_helper(values, times, n, values_new, width_before, width_after, NULL, NULL, &state, 0, *n);
+  STATS_END();
+}
+
+
+// Same as sma_linear(), but faster for regularly spaced observation times (see sma_regular), in which case the
+// result agrees with the one of sma_linear() only up to rounding errors
+void sma_linear_regular(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_linear()
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  if (sma_regular(SMA_LINEAR, values, times, *n, values_new, *width_before, *width_after) != 0)
+    sma_linear_helper(values, times, n, values_new, width_before, width_after, NULL, NULL, &state, 0, *n);
+  STATS_END();
+}
+
+
+/******************* Window plans ********************/
+
+// SMA_last(X, width) for a window plan (see rolling_plan), which must have been calculated for the same
+// observation times and window widths
+// -) the right end of each time window is taken from the plan, while the left end still needs to be compared to
+//    the observation times, because the time window of an SMA includes observations at t_i - width_before
+void sma_last_plan(const double values[], const double times[], const int lefts[], const int rights[],
+  const int *n, double values_new[], const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // lefts        ... array of first observation in each time window, see rolling_plan()
+  // rights       ... array of last observation in each time window, see rolling_plan()
+  // n            ... number of observations, i.e. length of 'values', 'times', 'lefts' and 'rights'
+  // values_new   ... array of length *n to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  sma_last_helper(values, times, n, values_new, width_before, width_after, lefts, rights, &state, 0, *n);
+  STATS_END();
+}
+
+
+// SMA_next(X, width) for a window plan
+void sma_next_plan(const double values[], const double times[], const int lefts[], const int rights[],
+  const int *n, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_last_plan()
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  sma_next_helper(values, times, n, values_new, width_before, width_after, lefts, rights, &state, 0, *n);
+  STATS_END();
+}
+
+
+// SMA_linear(X, width) for a window plan
+void sma_linear_plan(const double values[], const double times[], const int lefts[], const int rights[],
+  const int *n, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_last_plan()
+  
+  sma_state state = {0, 0, 0, 0, 0};
+  
+  STATS_BEGIN();
+  sma_linear_helper(values, times, n, values_new, width_before, width_after, lefts, rights, &state, 0, *n);
+  STATS_END();
+}
+
+/****************** END: Window plans ****************/
+
+
+/******************* Chunked interface ********************/
+
+// State of an SMA that processes a long time series in consecutive chunks, see sma_chunked_push()
+struct sma_chunked {
+  int scheme;             // interpolation scheme (SMA_LAST, SMA_NEXT or SMA_LINEAR)
+  double width_before;
+  double width_after;
+  sma_state state;        // loop-carried state, with positions relative to the buffer
+  double *values;         // buffer of the observations that are needed for the remaining output values
+  double *times;
+  double *out;            // output values for the observations in the buffer
+  int count;              // number of observations in buffer
+  int capacity;           // length of buffer arrays
+  int next;               // position in buffer of first observation without output value
+  long long num_removed;  // number of observations removed from the buffer (i.e. position of buffer start)
+};
+
+
+// Create the state of an SMA that processes a time series in chunks (NULL if out of memory)
+static sma_chunked *sma_chunked_new(int scheme, const double *width_before, const double *width_after)
+{
+  sma_chunked *chunked = malloc(sizeof(sma_chunked));
+  if (chunked == NULL)
+    return NULL;
+  
+  chunked->scheme = scheme;
+  chunked->width_before = *width_before;
+  chunked->width_after = *width_after;
+  memset(&chunked->state, 0, sizeof(sma_state));
+  chunked->values = chunked->times = chunked->out = NULL;
+  chunked->count = chunked->capacity = chunked->next = 0;
+  chunked->num_removed = 0;
+  return chunked;
+}
+
+
+sma_chunked *sma_last_chunked_new(const double *width_before, const double *width_after)
+{
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  return sma_chunked_new(SMA_LAST, width_before, width_after);
+}
+
+
+sma_chunked *sma_next_chunked_new(const double *width_before, const double *width_after)
+{
+  return sma_chunked_new(SMA_NEXT, width_before, width_after);
+}
+
+
+sma_chunked *sma_linear_chunked_new(const double *width_before, const double *width_after)
+{
+  return sma_chunked_new(SMA_LINEAR, width_before, width_after);
+}
+
+
+void sma_chunked_free(sma_chunked *chunked)
+{
+  if (chunked == NULL)
+    return;
+  free(chunked->values);
+  free(chunked->times);
+  free(chunked->out);
+  free(chunked);
+}
+
+
+// Number of observations that have been pushed, but whose output value has not been returned yet
+int sma_chunked_pending(const sma_chunked *chunked)
+{
+  return chunked->count - chunked->next;
+}
+
+
+// Remove the observations from the buffer that are no longer needed, i.e. that are before the observation
+// preceding the current time window (which is needed for the truncated area on the left end) and already have an
+// output value (see rolling_chunked_compact in rolling.c)
+static void sma_chunked_compact(sma_chunked *chunked)
+{
+  sma_state *state = &chunked->state;
+  int shift = MIN(chunked->next, MAX(0, state->left - 1));
+  int keep = chunked->count - shift;
+  
+  if ((shift == 0) || (shift < keep))
+    return;
+  
+  memmove(chunked->values, chunked->values + shift, keep * sizeof(double));
+  memmove(chunked->times, chunked->times + shift, keep * sizeof(double));
+  state->left -= shift;
+  state->right -= shift;
+  chunked->next -= shift;
+  chunked->count = keep;
+  chunked->num_removed += shift;
+}
+
+
+// Make room for at least 'capacity' observations in the buffer (returns 0 on success, -1 if out of memory)
+static int sma_chunked_reserve(sma_chunked *chunked, int capacity)
+{
+  double *values, *times, *out;
+  
+  if (capacity <= chunked->capacity)
+    return 0;
+  if (capacity < 2 * chunked->capacity)
+    capacity = 2 * chunked->capacity;
+  
+  // The old pointers remain valid if realloc fails
+  if ((values = realloc(chunked->values, capacity * sizeof(double))) == NULL)
+    return -1;
+  chunked->values = values;
+  if ((times = realloc(chunked->times, capacity * sizeof(double))) == NULL)
+    return -1;
+  chunked->times = times;
+  if ((out = realloc(chunked->out, capacity * sizeof(double))) == NULL)
+    return -1;
+  chunked->out = out;
+  chunked->capacity = capacity;
+  return 0;
+}
+
+
+// Calculate the output values of the observations next, ..., end - 1 in the buffer, and copy them to 'values_new'
+static void sma_chunked_run(sma_chunked *chunked, int end, double values_new[], int *n_new)
+{
+  int start = chunked->next;
+  double *out = chunked->out;
+  
+  *n_new = 0;
+  if (end <= start)
+    return;
+  
+  STATS_BEGIN();
+  if (chunked->scheme == SMA_LAST)
+    sma_last_helper(chunked->values, chunked->times, &chunked->count, out, &chunked->width_before,
+      &chunked->width_after, NULL, NULL, &chunked->state, start, end);
+  else if (chunked->scheme == SMA_NEXT)
+    sma_next_helper(chunked->values, chunked->times, &chunked->count, out, &chunked->width_before,
+      &chunked->width_after, NULL, NULL, &chunked->state, start, end);
+  else
+    sma_linear_helper(chunked->values, chunked->times, &chunked->count, out, &chunked->width_before,
+      &chunked->width_after, NULL, NULL, &chunked->state, start, end);
+  STATS_END();
+  
+  memcpy(values_new, out + start, (end - start) * sizeof(double));
+  *n_new = end - start;
+  chunked->next = end;
+}
+
+
+/*
+Add the next chunk of observations of a long time series to an SMA, and return the output values of all
+observations whose time window is complete
+-) works the same way as rolling_chunked_push() in rolling.h, i.e. the output value of an observation is only
+   known once an observation with a time after t_i + width_after has been pushed (or after sma_chunked_finish()
+   has been called), and only the observations of the current time window are kept between calls
+-) the concatenated output values are exactly the same as the output of sma_last(), sma_next() or sma_linear()
+   (and of sma_last_plan(), sma_next_plan() or sma_linear_plan()) for the whole time series, no matter how the
+   time series is split into chunks
+-) returns 0 on success, and -1 (without adding the chunk) if out of memory
+*/
+int sma_chunked_push(sma_chunked *chunked, const double values[], const double times[], const int *n,
+  double values_new[], int *n_new)
+{
+  // chunked    ... state created by sma_last_chunked_new(), sma_next_chunked_new() or sma_linear_chunked_new()
+  // values     ... array of time series values of chunk
+  // times      ... array of observation times of chunk (not smaller than times of previous chunks)
+  // n          ... number of observations in chunk, i.e. length of 'values' and 'times'
+  // values_new ... array of length *n + sma_chunked_pending(chunked) to store the output values
+  // n_new      ... number of output values stored in 'values_new'
+  
+  double *buffer_times;
+  int low, high;
+  
+  *n_new = 0;
+  sma_chunked_compact(chunked);
+  if (sma_chunked_reserve(chunked, chunked->count + *n) != 0)
+    return -1;
+  memcpy(chunked->values + chunked->count, values, *n * sizeof(double));
+  memcpy(chunked->times + chunked->count, times, *n * sizeof(double));
+  chunked->count += *n;
+  if (chunked->count == 0)
+    return 0;
+  
+  // Find the first observation whose time window might include future observations, i.e. with
+  // t_last <= t_i + width_after, using the same comparison as when expanding the time window
+  buffer_times = chunked->times;
+  low = chunked->next;
+  high = chunked->count - 1;   // always satisfies the condition
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (buffer_times[chunked->count - 1] <= buffer_times[mid] + chunked->width_after)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+  sma_chunked_run(chunked, low, values_new, n_new);
+  return 0;
+}
+
+
+// Return the output values of all remaining observations, after the last chunk has been pushed
+void sma_chunked_finish(sma_chunked *chunked, double values_new[], int *n_new)
+{
+  // chunked    ... state created by sma_last_chunked_new(), sma_next_chunked_new() or sma_linear_chunked_new()
+  // values_new ... array of length sma_chunked_pending(chunked) to store the output values
+  // n_new      ... number of output values stored in 'values_new'
+  
+  sma_chunked_run(chunked, chunked->count, values_new, n_new);
+}
+
+/****************** END: Chunked interface ****************/
+
+
+/*
+SMA for several rolling time windows in a single pass
+-) the observations are processed in blocks, and each block is passed to the SMA helper once for each time window
+   (with one loop-carried sma_state per time window), so 'values' and 'times' are read from memory only once,
+   while the block stays in the cache
+-) if out of memory, the output is NAN
+*/
+static void sma_multi(int scheme, const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths)
+{
+  // scheme ... interpolation scheme (SMA_LAST, SMA_NEXT or SMA_LINEAR)
+  
+  int num = *num_widths, block_size = 1024;
+  
+  // Trivial case
+  if ((*n == 0) || (num == 0))
+    return;
+  
+  // State of each rolling window, which is all zeros at the start (see sma_last())
+  sma_state *states = calloc(num, sizeof(sma_state));
+  if (states == NULL) {
+    for (int i = 0; i < *n * num; i++)
+      values_new[i] = NAN;
+    return;
+  }
+  
+  STATS_BEGIN();
+  for (int start = 0; start < *n; start += block_size) {
+    int end = MIN(start + block_size, *n);
+    for (int k = 0; k < num; k++) {
+      double *out = values_new + k * (*n);
+      if (scheme == SMA_LAST)
+        sma_last_helper(values, times, n, out, &widths_before[k], &widths_after[k], NULL, NULL, &states[k],
+          start, end);
+      else if (scheme == SMA_NEXT)
+        sma_next_helper(values, times, n, out, &widths_before[k], &widths_after[k], NULL, NULL, &states[k],
+          start, end);
+      else
+        sma_linear_helper(values, times, n, out, &widths_before[k], &widths_after[k], NULL, NULL, &states[k],
+          start, end);
+    }
+  }
+  STATS_END();
+  free(states);
+}
+
+
+// SMA_last(X, width) for several rolling time windows in a single pass (see sma_multi)
+// -) equivalent to calling sma_last() once for each window, but reads 'values' and 'times' only once
+void sma_last_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths)
+{
+  // values        ... array of time series values
+  // times         ... array of observation times
+  // n             ... number of observations, i.e. length of 'values' and 'times'
+  // values_new    ... array of length (*n) * (*num_widths) to store output in column-major order, i.e. the
+  //                   SMA for the k-th window at time t_i is stored in values_new[i + k * (*n)]
+  // widths_before ... array of (non-negative) widths of rolling window before t_i
+  // widths_after  ... array of (non-negative) widths of rolling window after t_i
+  // num_widths    ... number of rolling windows, i.e. length of 'widths_before' and 'widths_after'
+  
+  sma_multi(SMA_LAST, values, times, n, values_new, widths_before, widths_after, num_widths);
+}
+
+
+// SMA_next(X, width) for several rolling time windows in a single pass (see sma_multi)
+// -) equivalent to calling sma_next() once for each window, but reads 'values' and 'times' only once
+void sma_next_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths)
+{
+  // values        ... array of time series values
+  // times         ... array of observation times
+  // n             ... number of observations, i.e. length of 'values' and 'times'
+  // values_new    ... array of length (*n) * (*num_widths) to store output in column-major order, i.e. the
+  //                   SMA for the k-th window at time t_i is stored in values_new[i + k * (*n)]
+  // widths_before ... array of (non-negative) widths of rolling window before t_i
+  // widths_after  ... array of (non-negative) widths of rolling window after t_i
+  // num_widths    ... number of rolling windows, i.e. length of 'widths_before' and 'widths_after'
+  
+  sma_multi(SMA_NEXT, values, times, n, values_new, widths_before, widths_after, num_widths);
+}
+
+
+// SMA_linear(X, width) for several rolling time windows in a single pass (see sma_multi)
+// -) equivalent to calling sma_linear() once for each window, but reads 'values' and 'times' only once
+void sma_linear_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths)
+{
+  // values        ... array of time series values
+  // times         ... array of observation times
+  // n             ... number of observations, i.e. length of 'values' and 'times'
+  // values_new    ... array of length (*n) * (*num_widths) to store output in column-major order, i.e. the
+  //                   SMA for the k-th window at time t_i is stored in values_new[i + k * (*n)]
+  // widths_before ... array of (non-negative) widths of rolling window before t_i
+  // widths_after  ... array of (non-negative) widths of rolling window after t_i
+  // num_widths    ... number of rolling windows, i.e. length of 'widths_before' and 'widths_after'
+  
+  sma_multi(SMA_LINEAR, values, times, n, values_new, widths_before, widths_after, num_widths);
+}
+
+
+// The argument num_threads is the number of threads to use, all other arguments are the same as for the
+// sequential function
+
+
+// Same as sma_last(), but use several threads (see apply_parallel)
+void sma_last_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for sma_last()
+  
+  int interpolated = 1;
+  apply_parallel(sma_last, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as sma_next(), but use several threads (see apply_parallel)
+void sma_next_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for sma_next()
+  
+  int interpolated = 1;
+  apply_parallel(sma_next, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+// Same as sma_linear(), but use several threads (see apply_parallel)
+void sma_linear_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads)
+{
+  // num_threads ... number of threads to use, all other arguments are the same as for sma_linear()
+  
+  int interpolated = 1;
+  apply_parallel(sma_linear, &interpolated, values, times, n, values_new, width_before,
+    width_after, num_threads);
+}
+
+
+/*
+Calculate a SMA only at the output times 'times_out', which need not coincide with the observation times
+-) the rolling time window [s - width_before, s + width_after] around each output time s is moved by advancing
+   the indices of the first and last observation in the window; if the window jumps over all observations
+   in the previous window, the new indices are found via galloping search, so that the run-time is
+   O(number of output times * log(gap) + number of observations that enter the window)
+-) the interpolated time series is integrated over the window, including the segments at the window boundaries,
+   and constant before the first and after the last observation, like in sma_last(), sma_next() and sma_linear()
+*/
+static void sma_at(int scheme, const double values[], const double times[], int n, const double times_out[],
+  int n_out, double values_new[], double width_before, double width_after)
+{
+  int left = 0, right = -1;   // first and last observation in time window
+  double inner_area = 0;      // area between times[left] and times[right]
+  
+  for (int k = 0; k < n_out; k++) {
+    double t_left_new = times_out[k] - width_before, t_right_new = times_out[k] + width_after, area;
+    
+    // Jump over gaps without observations
+    if ((n == 0) || (right < 0) || (times[right] < t_left_new)) {
+      left = gallop_not_before(times, right + 1, n, t_left_new);
+      right = left - 1;
+      inner_area = 0;
+    }
+    
+    // Expand interval on right end
+    while ((right < n - 1) && (times[right + 1] <= t_right_new)) {
+      right++;
+      if (right > left) {
+        double dt = times[right] - times[right - 1];
+        if (scheme == SMA_LAST)
+          inner_area += values[right - 1] * dt;
+        else if (scheme == SMA_NEXT)
+          inner_area += values[right] * dt;
+        else
+          inner_area += (values[right] + values[right - 1]) / 2 * dt;
+      }
+    }
+    
+    // Shrink interval on left end
+    while ((left < right) && (times[left] < t_left_new)) {
+      double dt = times[left + 1] - times[left];
+      if (scheme == SMA_LAST)
+        inner_area -= values[left] * dt;
+      else if (scheme == SMA_NEXT)
+        inner_area -= values[left + 1] * dt;
+      else
+        inner_area -= (values[left] + values[left + 1]) / 2 * dt;
+      left++;
+    }
+    
+    if (n == 0)
+      area = NAN;
+    else if (left > right) {
+      // No observation in time window, so that it lies in the segment between observations 'right' and 'right + 1'
+      int j = right;
+      double dt = t_right_new - t_left_new;
+      if (j < 0)
+        area = values[0] * dt;
+      else if (j == n - 1)
+        area = values[n - 1] * dt;
+      else if (scheme == SMA_LAST)
+        area = values[j] * dt;
+      else if (scheme == SMA_NEXT)
+        area = values[j + 1] * dt;
+      else
+        area = (interpolate_linear(times[j], times[j + 1], values[j], values[j + 1], t_left_new) +
+          interpolate_linear(times[j], times[j + 1], values[j], values[j + 1], t_right_new)) / 2 * dt;
+    } else {
+      // Add truncated area on left and right end
+      double left_area, right_area;
+      if (left == 0)
+        left_area = values[0] * (times[0] - t_left_new);
+      else if (scheme == SMA_LAST)
+        left_area = values[left - 1] * (times[left] - t_left_new);
+      else if (scheme == SMA_NEXT)
+        left_area = values[left] * (times[left] - t_left_new);
+      else
+        left_area = trapezoid_left(times[left - 1], t_left_new, times[left], values[left - 1], values[left]);
+      if (right == n - 1)
+        right_area = values[n - 1] * (t_right_new - times[n - 1]);
+      else if (scheme == SMA_LAST)
+        right_area = values[right] * (t_right_new - times[right]);
+      else if (scheme == SMA_NEXT)
+        right_area = values[right] * (t_right_new - times[right]);   // like in sma_next()
+      else
+        right_area = trapezoid_right(times[right], t_right_new, times[right + 1], values[right], values[right + 1]);
+      area = inner_area + left_area + right_area;
+    }
+    
+    // Save SMA value for current time window
+    values_new[k] = area / (width_before + width_after);
+  }
+}
+
+
+// SMA_last(X, width) evaluated at the times 'times_out' (see sma_at)
+// -) same as sma_last() at the observation times (up to rounding errors), except for the first observation
+void sma_last_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *width_before, const double *width_after)
+{
+  // values       ... array of time series values
+  // times        ... array of observation times
+  // n            ... number of observations, i.e. length of 'values' and 'times'
+  // times_out    ... array of output times (not decreasing)
+  // n_out        ... number of output times, i.e. length of 'times_out'
+  // values_new   ... array of length *n_out to store output values
+  // width_before ... (non-negative) width of rolling window before each output time
+  // width_after  ... (non-negative) width of rolling window after each output time
+  
+  sma_at(SMA_LAST, values, times, *n, times_out, *n_out, values_new, *width_before, *width_after);
+}
+
+
+// SMA_next(X, width) evaluated at the times 'times_out' (see sma_at)
+// -) same as sma_next() at the observation times (up to rounding errors), except for the first observation
+void sma_next_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_last_at()
+  
+  sma_at(SMA_NEXT, values, times, *n, times_out, *n_out, values_new, *width_before, *width_after);
+}
+
+
+// SMA_linear(X, width) evaluated at the times 'times_out' (see sma_at)
+// -) same as sma_linear() at the observation times (up to rounding errors), except for the first observation
+void sma_linear_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_last_at()
+  
+  sma_at(SMA_LINEAR, values, times, *n, times_out, *n_out, values_new, *width_before, *width_after);
+}
+
+
+/******************* Two time series ********************/
+
+// Statistics of two time series, see sma_cross()
+enum {SMA_COV, SMA_COR, SMA_BETA};
+
+
+// Observations of a time series, and a constant that is subtracted from all values to reduce rounding errors
+typedef struct {
+  const double *values;
+  const double *times;
+  int n;
+  double shift;
+} uts_ref;
+
+
+// Position on the merged time axis of two time series
+typedef struct {
+  double time;   // current break point, i.e. an observation time of either time series (or the start time)
+  int ix, iy;    // last observation of X and Y not after 'time' (-1 if none)
+} merged_cursor;
+
+
+// Value at time t of an interpolated time series, where t lies between observations i and i + 1
+// -) constant before the first and after the last observation, like for the SMAs
+static inline double interpolated_value(int scheme, const uts_ref *x, int i, double t)
+{
+  if (i < 0)
+    return x->values[0] - x->shift;
+  if (i >= x->n - 1)
+    return x->values[x->n - 1] - x->shift;
+  if (scheme == SMA_LAST)
+    return x->values[i] - x->shift;
+  if (scheme == SMA_NEXT)
+    return x->values[i + 1] - x->shift;
+  return interpolate_linear(x->times[i], x->times[i + 1], x->values[i], x->values[i + 1], t) - x->shift;
+}
+
+
+/*
+Add sign * (integrals of X, Y, X^2, Y^2, X*Y over the interval [t0, t1]) to 'sums', where the interval lies
+between two consecutive break points of the merged time axis, so that both interpolated time series are linear
+(or constant) on the interval
+*/
+static inline void add_integrals(double sums[5], double sign, int scheme, const uts_ref *x, const uts_ref *y,
+  const merged_cursor *cursor, double t0, double t1)
+{
+  double x0 = interpolated_value(scheme, x, cursor->ix, t0), x1 = interpolated_value(scheme, x, cursor->ix, t1);
+  double y0 = interpolated_value(scheme, y, cursor->iy, t0), y1 = interpolated_value(scheme, y, cursor->iy, t1);
+  double length = sign * (t1 - t0);
+  
+  sums[0] += length * (x0 + x1) / 2;
+  sums[1] += length * (y0 + y1) / 2;
+  sums[2] += length * (x0 * x0 + x0 * x1 + x1 * x1) / 3;
+  sums[3] += length * (y0 * y0 + y0 * y1 + y1 * y1) / 3;
+  sums[4] += length * (2 * x0 * y0 + x0 * y1 + x1 * y0 + 2 * x1 * y1) / 6;
+}
+
+
+// Move a cursor to the last break point not after time 'target', add sign * (integrals over the traversed
+// segments) to 'sums', and return the number of traversed segments
+static int advance_cursor(merged_cursor *cursor, double sums[5], double sign, int scheme, const uts_ref *x,
+  const uts_ref *y, double target)
+{
+  int num_segments = 0;
+  
+  while (1) {
+    double next_x = (cursor->ix < x->n - 1) ? x->times[cursor->ix + 1] : INFINITY;
+    double next_y = (cursor->iy < y->n - 1) ? y->times[cursor->iy + 1] : INFINITY;
+    double next = MIN(next_x, next_y);
+    if (next > target)
+      return num_segments;
+    
+    num_segments++;
+    add_integrals(sums, sign, scheme, x, y, cursor, cursor->time, next);
+    cursor->time = next;
+    while ((cursor->ix < x->n - 1) && (x->times[cursor->ix + 1] <= next))
+      cursor->ix++;
+    while ((cursor->iy < y->n - 1) && (y->times[cursor->iy + 1] <= next))
+      cursor->iy++;
+  }
+}
+
+
+/*
+Calculate a rolling statistic of two time series X and Y with different observation times at the
+observation times of X
+-) like for the SMAs, the statistics are time-weighted averages of the interpolated time series over the time
+   window [t_i - width_before, t_i + width_after], e.g. the covariance is the average of
+   (X(t) - mean(X)) * (Y(t) - mean(Y)) over the window
+-) the two time axes are merged on the fly by moving a cursor for each end of the time window. The rolling
+   integrals of X, Y, X^2, Y^2, X*Y between the two cursors are updated incrementally, and the integrals over
+   the truncated segments at each end are added on the fly, so that the run-time is O(N_x + N_y)
+-) the values are shifted by a recent observation value of each time series to reduce rounding errors. The
+   rolling integrals are rebuilt from scratch (with new shifts) once more segments have left the time window
+   than are left in it, which bounds the accumulated rounding error, like for the running moments of the rolling
+   operators, at an amortized cost of O(1) per segment
+-) if X or Y is (almost) constant in a time window, i.e. if its variance is not larger than the rounding error
+   of calculating it, the correlation and beta are NAN (see near_zero_variance)
+*/
+// Return 1 if a time-weighted variance is not distinguishable from zero, i.e. not larger than the rounding errors
+// of the interpolation and integration, which are relative to the mean square E[X^2] of the (unshifted) values
+static inline int near_zero_variance(double var, double mean)
+{
+  // var  ... time-weighted variance
+  // mean ... time-weighted mean of the unshifted values
+  
+  return var <= 64 * DBL_EPSILON * (var + mean * mean);
+}
+
+
+static void sma_cross(int scheme, int stat, const double values_x[], const double times_x[], int n_x,
+  const double values_y[], const double times_y[], int n_y, double values_new[], double width_before,
+  double width_after)
+{
+  double width = width_before + width_after, sums[5] = {0, 0, 0, 0, 0};
+  int num_segments = 0, num_removed = 0, num_passed;
+  merged_cursor left, right;
+  
+  // Trivial cases
+  if (n_x == 0)
+    return;
+  if (n_y == 0) {
+    for (int i = 0; i < n_x; i++)
+      values_new[i] = NAN;
+    return;
+  }
+  
+  // Start both cursors at the left end of the first time window, or at the first observation time
+  uts_ref x = {values_x, times_x, n_x, values_x[0]}, y = {values_y, times_y, n_y, values_y[0]};
+  left.time = MIN(times_x[0] - width_before, times_y[0]);
+  left.ix = left.iy = -1;
+  while ((left.ix < n_x - 1) && (times_x[left.ix + 1] <= left.time))
+    left.ix++;
+  while ((left.iy < n_y - 1) && (times_y[left.iy + 1] <= left.time))
+    left.iy++;
+  right = left;
+  
+  for (int i = 0; i < n_x; i++) {
+    double t_left_new = times_x[i] - width_before, t_right_new = times_x[i] + width_after, window_sums[5];
+    
+    // Move both ends of the time window, and add the truncated segments at each end
+    // -) num_segments is the number of segments between the cursors, and num_removed the number of segments
+    //    that have left the time window since the rolling integrals were last built from scratch
+    num_segments += advance_cursor(&right, sums, 1, scheme, &x, &y, t_right_new);
+    num_passed = advance_cursor(&left, sums, -1, scheme, &x, &y, t_left_new);
+    num_segments -= num_passed;
+    num_removed += num_passed;
+    
+    // Rebuild the rolling integrals from scratch, shifted by the first observation value in the time window
+    if (num_removed > num_segments) {
+      merged_cursor cursor = left;
+      x.shift = values_x[MAX(0, left.ix)];
+      y.shift = values_y[MAX(0, left.iy)];
+      for (int k = 0; k < 5; k++)
+        sums[k] = 0;
+      num_segments = advance_cursor(&cursor, sums, 1, scheme, &x, &y, right.time);
+      num_removed = 0;
+    }
+    for (int k = 0; k < 5; k++)
+      window_sums[k] = sums[k];
+    add_integrals(window_sums, 1, scheme, &x, &y, &right, right.time, t_right_new);
+    add_integrals(window_sums, -1, scheme, &x, &y, &left, left.time, t_left_new);
+    
+    // Calculate statistic from the time-weighted moments
+    double mean_x = window_sums[0] / width, mean_y = window_sums[1] / width;
+    double var_x = window_sums[2] / width - mean_x * mean_x, var_y = window_sums[3] / width - mean_y * mean_y;
+    double cov = window_sums[4] / width - mean_x * mean_y;
+    if (stat == SMA_COV)
+      values_new[i] = cov;
+    else if (stat == SMA_COR)
+      values_new[i] = (near_zero_variance(var_x, mean_x + x.shift) || near_zero_variance(var_y, mean_y + y.shift)) ?
+        NAN : cov / sqrt(var_x * var_y);
+    else
+      values_new[i] = near_zero_variance(var_y, mean_y + y.shift) ? NAN : cov / var_y;
+  }
+}
+
+
+// Rolling covariance of X and Y using last-point interpolation, at the observation times of X (see sma_cross)
+void sma_cov_last(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // values_x     ... array of values of time series X
+  // times_x      ... array of observation times of time series X
+  // n_x          ... number of observations of X, i.e. length of 'values_x' and 'times_x'
+  // values_y     ... array of values of time series Y
+  // times_y      ... array of observation times of time series Y
+  // n_y          ... number of observations of Y, i.e. length of 'values_y' and 'times_y'
+  // values_new   ... array of length *n_x to store output time series values
+  // width_before ... (non-negative) width of rolling window before t_i
+  // width_after  ... (non-negative) width of rolling window after t_i
+  
+  sma_cross(SMA_LAST, SMA_COV, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling covariance of X and Y using next-point interpolation (see sma_cross)
+void sma_cov_next(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_NEXT, SMA_COV, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling covariance of X and Y using linear interpolation (see sma_cross)
+void sma_cov_linear(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_LINEAR, SMA_COV, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling correlation of X and Y using last-point interpolation (see sma_cross)
+void sma_cor_last(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_LAST, SMA_COR, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling correlation of X and Y using next-point interpolation (see sma_cross)
+void sma_cor_next(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_NEXT, SMA_COR, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling correlation of X and Y using linear interpolation (see sma_cross)
+void sma_cor_linear(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_LINEAR, SMA_COR, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling beta of X with respect to Y using last-point interpolation (see sma_cross)
+void sma_beta_last(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_LAST, SMA_BETA, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling beta of X with respect to Y using next-point interpolation (see sma_cross)
+void sma_beta_next(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_NEXT, SMA_BETA, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+
+// Rolling beta of X with respect to Y using linear interpolation (see sma_cross)
+void sma_beta_linear(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after)
+{
+  // all arguments are the same as for sma_cov_last()
+  
+  sma_cross(SMA_LINEAR, SMA_BETA, values_x, times_x, *n_x, values_y, times_y, *n_y, values_new, *width_before,
+    *width_after);
+}
+
+/****************** END: Two time series ****************/
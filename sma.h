@@ -14,4 +14,93 @@ void sma_next(const double values[], const double times[], const int *n, double
 void sma_linear(const double values[], const double times[], const int *n, double values_new[],
   const double *width_before, const double *width_after);
 
+// Faster versions of the above functions for regularly spaced observation times (i.e. with exactly equal differences
+// of consecutive observation times), whose results agree with the ones of the above functions up to rounding errors
+void sma_last_regular(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after);
+
+void sma_next_regular(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after);
+
+void sma_linear_regular(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after);
+
+void sma_last_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths);
+
+void sma_next_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths);
+
+void sma_linear_multi(const double values[], const double times[], const int *n, double values_new[],
+  const double widths_before[], const double widths_after[], const int *num_widths);
+
+// Multi-threaded versions of the above functions (via OpenMP if enabled at compile time)
+void sma_last_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void sma_next_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+void sma_linear_parallel(const double values[], const double times[], const int *n, double values_new[],
+  const double *width_before, const double *width_after, const int *num_threads);
+
+// Evaluate the above functions only at the output times 'times_out'
+void sma_last_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *width_before, const double *width_after);
+
+void sma_next_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *width_before, const double *width_after);
+
+void sma_linear_at(const double values[], const double times[], const int *n, const double times_out[],
+  const int *n_out, double values_new[], const double *width_before, const double *width_after);
+
+// Same as sma_last(), sma_next() and sma_linear(), but using a window plan for the same observation times and
+// window widths (see rolling_plan in rolling.h)
+void sma_last_plan(const double values[], const double times[], const int lefts[], const int rights[],
+  const int *n, double values_new[], const double *width_before, const double *width_after);
+
+void sma_next_plan(const double values[], const double times[], const int lefts[], const int rights[],
+  const int *n, double values_new[], const double *width_before, const double *width_after);
+
+void sma_linear_plan(const double values[], const double times[], const int lefts[], const int rights[],
+  const int *n, double values_new[], const double *width_before, const double *width_after);
+
+/*
+Chunked interface: process a time series that does not fit into memory in consecutive chunks
+-) only the observations of the current time window are kept between chunks, see sma_chunked_push() for details
+*/
+typedef struct sma_chunked sma_chunked;
+
+sma_chunked *sma_last_chunked_new(const double *width_before, const double *width_after);
+sma_chunked *sma_next_chunked_new(const double *width_before, const double *width_after);
+sma_chunked *sma_linear_chunked_new(const double *width_before, const double *width_after);
+void sma_chunked_free(sma_chunked *chunked);
+int sma_chunked_push(sma_chunked *chunked, const double values[], const double times[], const int *n,
+  double values_new[], int *n_new);
+void sma_chunked_finish(sma_chunked *chunked, double values_new[], int *n_new);
+int sma_chunked_pending(const sma_chunked *chunked);
+
+// Rolling covariance, correlation and beta of two time series with different observation times, evaluated at the
+// observation times of the first time series
+void sma_cov_last(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+void sma_cov_next(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+void sma_cov_linear(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+
+void sma_cor_last(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+void sma_cor_next(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+void sma_cor_linear(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+
+void sma_beta_last(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+void sma_beta_next(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+void sma_beta_linear(const double values_x[], const double times_x[], const int *n_x, const double values_y[],
+  const double times_y[], const int *n_y, double values_new[], const double *width_before, const double *width_after);
+
 #endif
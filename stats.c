@@ -0,0 +1,27 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+#include <string.h>
+#include "stats.h"
+
+#ifdef UTS_STATS
+
+UTS_THREAD_LOCAL uts_stats *uts_stats_active = NULL;
+
+
+// Add the counters of subsequent calls of the calling thread to 'stats' (or stop collecting statistics if NULL)
+void uts_stats_attach(uts_stats *stats)
+{
+  // stats ... statistics to update, or NULL
+  
+  uts_stats_active = stats;
+}
+
+
+// Set all counters to zero
+void uts_stats_reset(uts_stats *stats)
+{
+  memset(stats, 0, sizeof(uts_stats));
+}
+
+#endif
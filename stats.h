@@ -0,0 +1,116 @@
+// Copyright: 2012-2018 by Andreas Eckner
+// License: GPL-2 | GPL-3
+
+#ifndef _stats_h
+#define _stats_h
+
+/*
+Optional instrumentation of the hot paths of the operators, to find inputs that trigger expensive code paths
+-) only available if the library is compiled with -DUTS_STATS (plus stats.c), otherwise all counters are compiled
+   out and there is no run-time cost
+-) the counters are added to the statistics passed to uts_stats_attach(), until it is called with NULL
+-) the attached statistics are thread-local, i.e. each thread collects the counters of its own calls into the
+   statistics it has attached (if any). For the *_parallel functions and the batch interface, this means that
+   only the part of the work done by the calling thread is counted.
+*/
+typedef struct {
+  long long calls;             // number of calls of instrumented operators (nested calls are counted once)
+  long long cycles;            // elapsed CPU cycles (or clock() ticks on non-x86 platforms) of all calls
+  long long cycles_max;        // elapsed CPU cycles of the most expensive call
+  long long advances;          // number of moves of the left or right end of a time window by one observation
+  long long rescans;           // number of passes over all observations in a time window, see below
+  long long rescan_elements;   // number of observations touched by these passes
+  long long recomputations;    // number of rescans that recalculate an incrementally updated aggregate from scratch
+  long long taylor_steps;      // number of EMA_linear weights calculated via a Taylor expansion
+  long long peak_occupancy;    // largest number of observations in a time window
+  int depth;                   // nesting depth of current call (private)
+} uts_stats;
+
+/*
+Rescans by operator:
+-) rolling_sum, rolling_mean, rolling_product, rolling_aggregate*: recalculation of the front part of the
+   sliding window aggregation, once for every N observations (recomputation)
+-) rolling_sd, rolling_var, rolling_central_moment for m = 2, 3, 4, rolling_stats: recalculation of the running
+   moments after catastrophic cancellation (recomputation)
+-) rolling_central_moment for other m: one pass per observation
+*/
+
+#ifdef UTS_STATS
+
+#include <time.h>
+
+// Storage class of thread-local variables (C11, or the equivalent compiler extension for C99)
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#  define UTS_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#  define UTS_THREAD_LOCAL __declspec(thread)
+#else
+#  define UTS_THREAD_LOCAL __thread
+#endif
+
+// Statistics of current calls of this thread (NULL if not collected)
+extern UTS_THREAD_LOCAL uts_stats *uts_stats_active;
+
+void uts_stats_attach(uts_stats *stats);
+void uts_stats_reset(uts_stats *stats);
+
+
+// Current value of the cycle counter
+static inline long long uts_stats_clock(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  return (long long) __builtin_ia32_rdtsc();
+#else
+  return (long long) clock();
+#endif
+}
+
+
+// Start of an instrumented call (returns the current value of the cycle counter)
+static inline long long uts_stats_begin(void)
+{
+  if (uts_stats_active == NULL)
+    return 0;
+  uts_stats_active->depth++;
+  return uts_stats_clock();
+}
+
+
+// End of an instrumented call, which was started at cycle 'start'
+static inline void uts_stats_end(long long start)
+{
+  long long cycles;
+  
+  if ((uts_stats_active == NULL) || (uts_stats_active->depth == 0))
+    return;
+  if (--uts_stats_active->depth > 0)
+    return;
+  cycles = uts_stats_clock() - start;
+  uts_stats_active->calls++;
+  uts_stats_active->cycles += cycles;
+  if (cycles > uts_stats_active->cycles_max)
+    uts_stats_active->cycles_max = cycles;
+}
+
+#  define STATS_ADD(field, k) do { if (uts_stats_active != NULL) uts_stats_active->field += (k); } while (0)
+#  define STATS_MAX(field, k) \
+     do { if ((uts_stats_active != NULL) && ((k) > uts_stats_active->field)) uts_stats_active->field = (k); } while (0)
+#  define STATS_RESCAN(k, recomputation) \
+     do { STATS_ADD(rescans, 1); STATS_ADD(rescan_elements, k); STATS_ADD(recomputations, recomputation); } while (0)
+#  define STATS_BEGIN() long long stats_start = uts_stats_begin()
+#  define STATS_END() uts_stats_end(stats_start)
+
+#else
+
+static inline void uts_stats_attach(uts_stats *stats) { (void) stats; }
+static inline void uts_stats_reset(uts_stats *stats) { (void) stats; }
+
+#  define STATS_ADD(field, k) ((void) 0)
+#  define STATS_MAX(field, k) ((void) 0)
+#  define STATS_RESCAN(k, recomputation) ((void) 0)
+#  define STATS_BEGIN() ((void) 0)
+#  define STATS_END() ((void) 0)
+
+#endif
+
+#endif
@@ -4,10 +4,16 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ema.h"
 #include "sma.h"
 #include "rolling.h"
+#include "parallel.h"
+#include "keyed.h"
+#include "stats.h"
+#include "columnar.h"
+#include "arrow.h"
 
 
 // Print nicely formatted observation times and values for an unevenly spaced time series
@@ -27,6 +33,43 @@ void print_uts(double values[], double times[], int n)
 }
 
 
+// Return the maximum absolute difference between two arrays, relative to the range of 'values'
+double max_rel_diff(const double a[], const double b[], const double values[], int n)
+{
+  double diff = 0, min = values[0], max = values[0];
+  
+  for (int i=0; i < n; i++) {
+    diff = fmax(diff, fabs(a[i] - b[i]));
+    min = fmin(min, values[i]);
+    max = fmax(max, values[i]);
+  }
+  return diff / (max - min);
+}
+
+
+// Return 1 if two arrays have the same values (where NAN is the same as NAN), and 0 otherwise
+int identical(const double a[], const double b[], int n)
+{
+  for (int i=0; i < n; i++) {
+    if ((a[i] != b[i]) && !(isnan(a[i]) && isnan(b[i])))
+      return 0;
+  }
+  return 1;
+}
+
+
+// Release callbacks of the Arrow arrays in the demo, whose buffers are owned by main()
+void release_schema(struct ArrowSchema *schema)
+{
+  schema->release = NULL;
+}
+
+void release_array(struct ArrowArray *array)
+{
+  array->release = NULL;
+}
+
+
 // Demo of functionality
 int main()
 {
@@ -72,11 +115,36 @@ int main()
   printf("\nrolling_median(X, %.1f, %.1f)\n", width_before, width_after);
   print_uts(out, times, n);
   
+  // rolling quantiles
+  double probs[] = {0.25, 0.75}, out_quantiles[2 * n];
+  int num_probs = 2;
+  rolling_quantile(values, times, &n, out_quantiles, &width_before, &width_after, probs, &num_probs);
+  for (int j = 0; j < num_probs; j++) {
+    printf("\nrolling_quantile(X, %.1f, %.1f, %.2f)\n", width_before, width_after, probs[j]);
+    print_uts(out_quantiles + j * n, times, n);
+  }
+  
   // rolling maximum
   rolling_max(values, times, &n, out, &width_before, &width_after);
   printf("\nrolling_max(X, %.1f, %.1f)\n", width_before, width_after);
   print_uts(out, times, n);
   
+  // rolling maximum via an arbitrary associative operation
+  double minus_infinity = -INFINITY;
+  rolling_aggregate(values, times, &n, out, &width_before, &width_after, fmax, &minus_infinity);
+  printf("\nrolling_aggregate(X, %.1f, %.1f, fmax)\n", width_before, width_after);
+  print_uts(out, times, n);
+  
+  // rolling maximum and minimum via a window plan, which is calculated once for both operators
+  int lefts[n], rights[n];
+  rolling_plan(times, &n, &width_before, &width_after, lefts, rights);
+  rolling_max_plan(values, lefts, rights, &n, out);
+  printf("\nrolling_max_plan(X, plan(%.1f, %.1f))\n", width_before, width_after);
+  print_uts(out, times, n);
+  rolling_min_plan(values, lefts, rights, &n, out);
+  printf("\nrolling_min_plan(X, plan(%.1f, %.1f))\n", width_before, width_after);
+  print_uts(out, times, n);
+  
   // rolling minimum
   rolling_min(values, times, &n, out, &width_before, &width_after);
   printf("\nrolling_min(X, %.1f, %.1f)\n", width_before, width_after);
@@ -144,6 +212,394 @@ int main()
   printf("\nEMA_linear(X, %.1f) ... an EMA with a slow time decay produces nearly constant output\n", tau_long);
   print_uts(out, times, n);
 
+  // EMA with linear interpolation, evaluated on a regular grid instead of at the observation times
+  double times_grid[] = {0, 1, 2, 3, 4, 5, 6};
+  int n_grid = sizeof(times_grid) / sizeof(double);
+  double out_grid[n_grid];
+  ema_linear_at(values, times, &n, times_grid, &n_grid, out_grid, &tau);
+  printf("\nEMA_linear(X, %.1f) evaluated at times 0, 1, ..., 6\n", tau);
+  print_uts(out_grid, times_grid, n_grid);
+
+
+  /*
+    Batch Interface
+  */
+  printf("\n\n##### Batch Interface #####\n");
+
+  // Split X into two time series, stored in CSR layout, and process both with a single call
+  int offsets[] = {0, 3, n}, num_series = 2, num_threads = 2, status[2];
+  rolling_batch(rolling_sum, values, times, offsets, &num_series, out, &width_before, &width_after, &num_threads, status);
+  printf("\nrolling_batch(rolling_sum, X[1:3] and X[4:%d], %.1f, %.1f), status = (%d, %d)\n", n, width_before, width_after,
+    status[0], status[1]);
+  print_uts(out, times, n);
+
+  // Treat X as two interleaved time series with keys 1 and 2, and calculate an EMA for each of them
+  int keys[] = {1, 2, 1, 2, 1, 2};
+  ema_last_keyed(keys, values, times, &n, out, &tau);
+  printf("\nema_last_keyed(X, keys = (1, 2, 1, 2, 1, 2), %.1f)\n", tau);
+  print_uts(out, times, n);
+
+  /*
+    Accuracy modes of EMAs
+  */
+  printf("\n\n##### Accuracy Modes of EMAs #####\n\n");
+
+  // Compare the approximate EMAs of a random, unevenly spaced time series with EMA_EXACT, relative to the
+  // range of the values, against the documented maximum error (see ema_approx in ema.c)
+  int n_rand = 10000, accuracies[] = {EMA_APPROX_1E12, EMA_APPROX_1E7}, exact = EMA_EXACT;
+  double *values_rand = malloc(n_rand * sizeof(double)), *times_rand = malloc(n_rand * sizeof(double));
+  double *out_exact = malloc(n_rand * sizeof(double)), *out_approx = malloc(n_rand * sizeof(double));
+  double tau_rand = 2, eps[] = {1e-12, 1e-7};
+  const char *accuracy_names[] = {"EMA_APPROX_1E12", "EMA_APPROX_1E7"}, *scheme_names[] = {"next", "last", "linear"};
+  void (*ema_funcs[])(const double[], const double[], const int*, double[], const double*, const int*) =
+    {ema_next_accuracy, ema_last_accuracy, ema_linear_accuracy};
+  srand(1);
+  for (int i=0; i < n_rand; i++) {
+    times_rand[i] = (i == 0 ? 0 : times_rand[i-1]) - log((rand() + 1.0) / (RAND_MAX + 2.0));
+    values_rand[i] = rand() / (double) RAND_MAX;
+  }
+  for (int s=0; s < 3; s++) {
+    ema_funcs[s](values_rand, times_rand, &n_rand, out_exact, &tau_rand, &exact);
+    for (int a=0; a < 2; a++) {
+      ema_funcs[s](values_rand, times_rand, &n_rand, out_approx, &tau_rand, &accuracies[a]);
+      double diff = max_rel_diff(out_approx, out_exact, values_rand, n_rand), bound = (s == 2 ? 2 : 1) * eps[a];
+      printf("ema_%s_accuracy(%s): max. error %.1e, bound %.0e ... %s\n", scheme_names[s], accuracy_names[a],
+        diff, bound, diff <= bound ? "OK" : "FAIL");
+    }
+  }
+
+  /*
+    Consistency checks
+  */
+  printf("\n\n##### Consistency Checks #####\n\n");
+
+  // Streaming interface of EMAs vs. array-based functions, which produce exactly the same values
+  void (*ema_inits[])(ema_state*, const double*) = {ema_next_init, ema_last_init, ema_linear_init};
+  double (*ema_updates[])(ema_state*, const double*, const double*) =
+    {ema_next_update, ema_last_update, ema_linear_update};
+  void (*ema_arrays[])(const double[], const double[], const int*, double[], const double*) =
+    {ema_next, ema_last, ema_linear};
+  for (int s=0; s < 3; s++) {
+    ema_state state;
+    ema_arrays[s](values_rand, times_rand, &n_rand, out_exact, &tau_rand);
+    ema_inits[s](&state, &tau_rand);
+    for (int i=0; i < n_rand; i++)
+      out_approx[i] = ema_updates[s](&state, &times_rand[i], &values_rand[i]);
+    double diff = max_rel_diff(out_approx, out_exact, values_rand, n_rand);
+    printf("ema_%s_update vs. ema_%s: max. error %.1e, bound 0 ... %s\n", scheme_names[s], scheme_names[s], diff,
+      diff == 0 ? "OK" : "FAIL");
+  }
+
+  // Streaming interface of rolling operators vs. array-based functions with width_after = 0, which agree up to
+  // rounding errors for distinct observation times
+  int stream_ops[] = {ROLLING_SUM, ROLLING_MAX, ROLLING_MEDIAN, ROLLING_VAR};
+  const char *stream_names[] = {"sum", "max", "median", "var"};
+  void (*rolling_arrays[])(const double[], const double[], const int*, double[], const double*, const double*) =
+    {rolling_sum, rolling_max, rolling_median, rolling_var};
+  double zero = 0;
+  for (int s=0; s < 4; s++) {
+    rolling_stream *stream = rolling_stream_new(&stream_ops[s], &width_before);
+    rolling_arrays[s](values_rand, times_rand, &n_rand, out_exact, &width_before, &zero);
+    for (int i=0; i < n_rand; i++)
+      out_approx[i] = rolling_stream_push(stream, &times_rand[i], &values_rand[i]);
+    rolling_stream_free(stream);
+    double diff = max_rel_diff(out_approx, out_exact, values_rand, n_rand);
+    printf("rolling_stream_push vs. rolling_%s: max. error %.1e, bound 1e-12 ... %s\n", stream_names[s], diff,
+      diff <= 1e-12 ? "OK" : "FAIL");
+  }
+
+  // Rolling quantiles vs. rolling_min, rolling_median and rolling_max, which agree up to rounding errors (because
+  // the median of two values is calculated as their average, and the quantile by linear interpolation), and NAN
+  // for probabilities outside of [0, 1]
+  double probs_check[] = {0, 0.5, 1, -0.1, 1.5, NAN};
+  int num_probs_check = 6;
+  const char *quantile_names[] = {"rolling_min", "rolling_median", "rolling_max"};
+  void (*quantile_arrays[])(const double[], const double[], const int*, double[], const double*, const double*) =
+    {rolling_min, rolling_median, rolling_max};
+  double *out_probs = malloc(num_probs_check * n_rand * sizeof(double));
+  rolling_quantile(values_rand, times_rand, &n_rand, out_probs, &width_before, &width_after, probs_check,
+    &num_probs_check);
+  for (int j=0; j < num_probs_check; j++) {
+    double diff = 0;
+    if (j < 3) {
+      quantile_arrays[j](values_rand, times_rand, &n_rand, out_exact, &width_before, &width_after);
+      diff = max_rel_diff(out_probs + j * n_rand, out_exact, values_rand, n_rand);
+    } else {
+      for (int i=0; i < n_rand; i++)
+        diff = fmax(diff, isnan(out_probs[i + j * n_rand]) ? 0 : INFINITY);
+    }
+    printf("rolling_quantile(prob = %.1f) vs. %s: max. error %.1e, bound 1e-12 ... %s\n", probs_check[j],
+      (j < 3) ? quantile_names[j] : "NAN", diff, diff <= 1e-12 ? "OK" : "FAIL");
+  }
+  free(out_probs);
+  
+  // Fused rolling statistics vs. individual operators, which agree up to rounding errors (because the sum is
+  // updated by subtraction instead of sliding window aggregation)
+  int stats_ops[] = {ROLLING_NUM_OBS, ROLLING_SUM, ROLLING_MEAN, ROLLING_MAX, ROLLING_MIN, ROLLING_SD, ROLLING_VAR};
+  const char *stats_names[] = {"num_obs", "sum", "mean", "max", "min", "sd", "var"};
+  void (*stats_arrays[])(const double[], const double[], const int*, double[], const double*, const double*) =
+    {rolling_num_obs, rolling_sum, rolling_mean, rolling_max, rolling_min, rolling_sd, rolling_var};
+  int stats_mask = 0;
+  for (int k=0; k < 7; k++)
+    stats_mask |= 1 << stats_ops[k];
+  double *out_stats = malloc(7 * n_rand * sizeof(double));
+  rolling_stats(values_rand, times_rand, &n_rand, out_stats, &width_before, &width_after, &stats_mask);
+  for (int k=0; k < 7; k++) {
+    stats_arrays[k](values_rand, times_rand, &n_rand, out_exact, &width_before, &width_after);
+    double diff = max_rel_diff(out_stats + k * n_rand, out_exact, values_rand, n_rand);
+    printf("rolling_stats vs. rolling_%s: max. error %.1e, bound 1e-12 ... %s\n", stats_names[k], diff,
+      diff <= 1e-12 ? "OK" : "FAIL");
+  }
+  free(out_stats);
+  
+  // Multi-threaded EMAs vs. sequential EMAs for a random time series of 100000 observations, which agree up to
+  // about 50 ulp of the largest absolute value (see ema_parallel in ema.c), both for a half-life that is short
+  // and one that is long compared to the time span of a block. Without OpenMP, the calculation is sequential.
+  int n_long = 100000, num_threads_long = 4;
+  double taus_long[] = {2, 10000};
+  void (*ema_parallels[])(const double[], const double[], const int*, double[], const double*, const int*) =
+    {ema_next_parallel, ema_last_parallel, ema_linear_parallel};
+  double *values_long = malloc(n_long * sizeof(double)), *times_long = malloc(n_long * sizeof(double));
+  double *out_serial = malloc(n_long * sizeof(double)), *out_parallel = malloc(n_long * sizeof(double));
+  for (int i=0; i < n_long; i++) {
+    times_long[i] = (i == 0 ? 0 : times_long[i-1]) - log((rand() + 1.0) / (RAND_MAX + 2.0));
+    values_long[i] = rand() / (double) RAND_MAX;
+  }
+  for (int s=0; s < 3; s++) {
+    for (int k=0; k < 2; k++) {
+      ema_arrays[s](values_long, times_long, &n_long, out_serial, &taus_long[k]);
+      ema_parallels[s](values_long, times_long, &n_long, out_parallel, &taus_long[k], &num_threads_long);
+      double diff = max_rel_diff(out_parallel, out_serial, values_long, n_long);
+      printf("ema_%s_parallel(tau = %.0f, %d threads) vs. ema_%s: max. error %.1e, bound 1e-13 ... %s\n",
+        scheme_names[s], taus_long[k], num_threads_long, scheme_names[s], diff, diff <= 1e-13 ? "OK" : "FAIL");
+    }
+  }
+  
+  // Multi-threaded rolling operators and SMAs vs. sequential ones (with 2 threads, so that the time series is split
+  // into blocks), which are identical for operators without running sums, and agree up to rounding errors otherwise
+  int num_threads_rolling = 2;
+  const char *parallel_names[] = {"rolling_max", "rolling_median", "rolling_sum", "sma_linear"};
+  void (*parallel_arrays[])(const double[], const double[], const int*, double[], const double*, const double*) =
+    {rolling_max, rolling_median, rolling_sum, sma_linear};
+  void (*parallel_funcs[])(const double[], const double[], const int*, double[], const double*, const double*,
+    const int*) = {rolling_max_parallel, rolling_median_parallel, rolling_sum_parallel, sma_linear_parallel};
+  for (int k=0; k < 4; k++) {
+    parallel_arrays[k](values_long, times_long, &n_long, out_serial, &width_before, &width_after);
+    parallel_funcs[k](values_long, times_long, &n_long, out_parallel, &width_before, &width_after,
+      &num_threads_rolling);
+    double diff = max_rel_diff(out_parallel, out_serial, values_long, n_long), bound = (k < 2) ? 0 : 1e-12;
+    printf("%s_parallel(%d threads) vs. %s: max. error %.1e, bound %.0e ... %s\n", parallel_names[k],
+      num_threads_rolling, parallel_names[k], diff, bound, diff <= bound ? "OK" : "FAIL");
+  }
+  free(values_long);
+  free(times_long);
+  free(out_serial);
+  free(out_parallel);
+  
+  // SMAs evaluated at the observation times vs. the SMAs, which agree up to rounding errors (except for the first
+  // observation, whose SMA is defined to be its value)
+  void (*sma_ats[])(const double[], const double[], const int*, const double[], const int*, double[], const double*,
+    const double*) = {sma_next_at, sma_last_at, sma_linear_at};
+  void (*sma_arrays[])(const double[], const double[], const int*, double[], const double*, const double*) =
+    {sma_next, sma_last, sma_linear};
+  for (int s=0; s < 3; s++) {
+    sma_arrays[s](values_rand, times_rand, &n_rand, out_exact, &width_before, &width_after);
+    sma_ats[s](values_rand, times_rand, &n_rand, times_rand, &n_rand, out_approx, &width_before, &width_after);
+    double diff = max_rel_diff(out_approx + 1, out_exact + 1, values_rand, n_rand - 1);
+    printf("sma_%s_at(times = observation times) vs. sma_%s: max. error %.1e, bound 1e-12 ... %s\n",
+      scheme_names[s], scheme_names[s], diff, diff <= 1e-12 ? "OK" : "FAIL");
+  }
+  
+  // SMAs for regularly spaced observation times vs. the general SMAs, which agree up to rounding errors
+  void (*sma_regulars[])(const double[], const double[], const int*, double[], const double*, const double*) =
+    {sma_next_regular, sma_last_regular, sma_linear_regular};
+  double *times_regular = malloc(n_rand * sizeof(double));
+  for (int i=0; i < n_rand; i++)
+    times_regular[i] = 0.5 * i;
+  for (int s=0; s < 3; s++) {
+    sma_arrays[s](values_rand, times_regular, &n_rand, out_exact, &width_before, &width_after);
+    sma_regulars[s](values_rand, times_regular, &n_rand, out_approx, &width_before, &width_after);
+    double diff = max_rel_diff(out_approx, out_exact, values_rand, n_rand);
+    printf("sma_%s_regular vs. sma_%s: max. error %.1e, bound 1e-12 ... %s\n", scheme_names[s], scheme_names[s],
+      diff, diff <= 1e-12 ? "OK" : "FAIL");
+  }
+  
+  // Rolling operators with empty time windows (width_before = 0, so that the time window (t_i, t_i + width_after]
+  // does not contain any observation for some t_i) vs. the values for an empty time window
+  double values_empty[] = {1, 2, 3, 4}, times_empty[] = {0, 5, 6, 7}, widths_after_empty[] = {2, 0};
+  double expected_empty[2][4][4] = {
+    {{0, 7, 4, 0}, {NAN, 3.5, 4, NAN}, {1, 12, 4, 1}, {-INFINITY, 4, 4, -INFINITY}},
+    {{0, 0, 0, 0}, {NAN, NAN, NAN, NAN}, {1, 1, 1, 1}, {-INFINITY, -INFINITY, -INFINITY, -INFINITY}}};
+  const char *empty_names[] = {"sum", "mean", "product", "aggregate"};
+  void (*empty_arrays[])(const double[], const double[], const int*, double[], const double*, const double*) =
+    {rolling_sum, rolling_mean, rolling_product};
+  rolling_plan_operator empty_plans[] = {rolling_sum_plan, rolling_mean_plan, rolling_product_plan};
+  int empty_ops[] = {ROLLING_SUM, ROLLING_MEAN, ROLLING_PRODUCT}, chunk_size_empty = 1;
+  int n_empty = 4, offsets_empty[] = {0, 4}, num_series_empty = 1, status_empty, lefts_empty[4], rights_empty[4];
+  double out_empty[4];
+  for (int w=0; w < 2; w++) {
+    for (int s=0; s < 4; s++) {
+      int ok;
+      if (s == 3) {
+        rolling_aggregate(values_empty, times_empty, &n_empty, out_empty, &zero, &widths_after_empty[w], fmax,
+          &minus_infinity);
+        ok = identical(out_empty, expected_empty[w][s], n_empty);
+      } else {
+        empty_arrays[s](values_empty, times_empty, &n_empty, out_empty, &zero, &widths_after_empty[w]);
+        ok = identical(out_empty, expected_empty[w][s], n_empty);
+        rolling_batch(empty_arrays[s], values_empty, times_empty, offsets_empty, &num_series_empty, out_empty, &zero,
+          &widths_after_empty[w], &num_threads, &status_empty);
+        ok = ok && (status_empty == BATCH_OK) && identical(out_empty, expected_empty[w][s], n_empty);
+        rolling_plan(times_empty, &n_empty, &zero, &widths_after_empty[w], lefts_empty, rights_empty);
+        empty_plans[s](values_empty, lefts_empty, rights_empty, &n_empty, out_empty);
+        ok = ok && identical(out_empty, expected_empty[w][s], n_empty);
+        int num_done_empty = 0, num_new_empty;
+        rolling_chunked *chunked_empty = rolling_chunked_new(&empty_ops[s], &zero, &widths_after_empty[w]);
+        for (int i=0; i < n_empty; i++) {
+          rolling_chunked_push(chunked_empty, values_empty + i, times_empty + i, &chunk_size_empty,
+            out_empty + num_done_empty, &num_new_empty);
+          num_done_empty += num_new_empty;
+        }
+        rolling_chunked_finish(chunked_empty, out_empty + num_done_empty, &num_new_empty);
+        num_done_empty += num_new_empty;
+        rolling_chunked_free(chunked_empty);
+        ok = ok && (num_done_empty == n_empty) && identical(out_empty, expected_empty[w][s], n_empty);
+      }
+      printf("rolling_%s(0, %.0f) with empty time windows vs. known values ... %s\n", empty_names[s],
+        widths_after_empty[w], ok ? "OK" : "FAIL");
+    }
+  }
+  
+  // Rolling product of a time series with zeros vs. the known values, for time windows with zeros, without
+  // zeros and without observations, both for the array-based function and the streaming interface
+  double values_zeros[] = {2, 0, 3, 0.5, 4, 0, 0, 5}, times_zeros[] = {0, 1, 2, 3, 4, 5, 6, 10};
+  double expected_zeros_before[] = {2, 0, 0, 1.5, 2, 0, 0, 5}, expected_zeros_after[] = {0, 3, 0.5, 4, 0, 0, 1, 1};
+  double width_zeros = 2, width_one = 1, out_zeros[8];
+  int n_zeros = 8, op_product = ROLLING_PRODUCT;
+  rolling_product(values_zeros, times_zeros, &n_zeros, out_zeros, &width_zeros, &zero);
+  printf("rolling_product(X_zeros, %.0f, 0) vs. known values ... %s\n", width_zeros,
+    identical(out_zeros, expected_zeros_before, n_zeros) ? "OK" : "FAIL");
+  rolling_product(values_zeros, times_zeros, &n_zeros, out_zeros, &zero, &width_one);
+  printf("rolling_product(X_zeros, 0, %.0f) vs. known values ... %s\n", width_one,
+    identical(out_zeros, expected_zeros_after, n_zeros) ? "OK" : "FAIL");
+  rolling_stream *stream_zeros = rolling_stream_new(&op_product, &width_zeros);
+  for (int i=0; i < n_zeros; i++)
+    out_zeros[i] = rolling_stream_push(stream_zeros, &times_zeros[i], &values_zeros[i]);
+  rolling_stream_free(stream_zeros);
+  printf("rolling_stream_push(ROLLING_PRODUCT, X_zeros, %.0f) vs. known values ... %s\n", width_zeros,
+    identical(out_zeros, expected_zeros_before, n_zeros) ? "OK" : "FAIL");
+  
+  /*
+    Chunked interface
+  */
+  printf("\n\n##### Chunked Interface #####\n\n");
+
+  // Process the random time series in chunks of 1000 observations, and compare with a single in-memory call
+  int chunk_size = 1000, num_done = 0, num_new, op_sum = ROLLING_SUM;
+  rolling_chunked *chunked_sum = rolling_chunked_new(&op_sum, &width_before, &width_after);
+  rolling_sum(values_rand, times_rand, &n_rand, out_exact, &width_before, &width_after);
+  for (int start=0; start < n_rand; start += chunk_size) {
+    rolling_chunked_push(chunked_sum, values_rand + start, times_rand + start, &chunk_size, out_approx + num_done,
+      &num_new);
+    num_done += num_new;
+  }
+  rolling_chunked_finish(chunked_sum, out_approx + num_done, &num_new);
+  num_done += num_new;
+  rolling_chunked_free(chunked_sum);
+  printf("rolling_chunked_push(ROLLING_SUM, X_rand in chunks of %d, %.1f, %.1f): %d output values ... %s\n",
+    chunk_size, width_before, width_after, num_done,
+    (num_done == n_rand) && (max_rel_diff(out_approx, out_exact, values_rand, n_rand) == 0) ? "OK" : "FAIL");
+
+  // The same for an SMA, both for the random observation times and for regularly spaced ones
+  double *times_chunked[] = {times_rand, times_regular};
+  const char *times_chunked_names[] = {"X_rand", "X_rand on a regular grid"};
+  for (int g=0; g < 2; g++) {
+    num_done = 0;
+    sma_chunked *chunked_sma = sma_linear_chunked_new(&width_before, &width_after);
+    sma_linear(values_rand, times_chunked[g], &n_rand, out_exact, &width_before, &width_after);
+    for (int start=0; start < n_rand; start += chunk_size) {
+      sma_chunked_push(chunked_sma, values_rand + start, times_chunked[g] + start, &chunk_size,
+        out_approx + num_done, &num_new);
+      num_done += num_new;
+    }
+    sma_chunked_finish(chunked_sma, out_approx + num_done, &num_new);
+    num_done += num_new;
+    sma_chunked_free(chunked_sma);
+    printf("sma_chunked_push(SMA_linear, %s in chunks of %d, %.1f, %.1f): %d output values ... %s\n",
+      times_chunked_names[g], chunk_size, width_before, width_after, num_done,
+      (num_done == n_rand) && (max_rel_diff(out_approx, out_exact, values_rand, n_rand) == 0) ? "OK" : "FAIL");
+  }
+
+  /*
+    Binary columnar files
+  */
+  printf("\n\n##### Binary Columnar Files #####\n");
+
+  // Write X to a file, and calculate a rolling mean directly from the memory-mapped file into a new file
+  int num_columns = 1, column = 0, flags = COLUMNAR_SEQUENTIAL;
+  long long n_long_file = n;
+  columnar_write("test_input.uts", times, values, &n, &num_columns);
+  columnar_file *file_in = columnar_open("test_input.uts", &flags);
+  columnar_file *file_out = columnar_create("test_output.uts", &n_long_file, &num_columns, &flags);
+  if ((file_in != NULL) && (file_out != NULL)) {
+    int n_file = (int) columnar_length(file_in);
+    memcpy(columnar_times(file_out), columnar_times(file_in), n_file * sizeof(double));
+    rolling_mean(columnar_values(file_in, &column), columnar_times(file_in), &n_file,
+      columnar_values(file_out, &column), &width_before, &width_after);
+    printf("\nrolling_mean(X, %.1f, %.1f) from and to memory-mapped files\n", width_before, width_after);
+    print_uts(columnar_values(file_out, &column), columnar_times(file_out), n_file);
+  }
+  columnar_close(file_in);
+  columnar_close(file_out);
+  remove("test_input.uts");
+  remove("test_output.uts");
+
+  /*
+    Arrow C Data Interface
+  */
+  printf("\n\n##### Arrow C Data Interface #####\n");
+
+  // Wrap X in Arrow arrays without copying, with the value of the third observation marked as null
+  uint8_t validity[] = {0xFB};
+  const void *buffers_values[] = {validity, values}, *buffers_times[] = {NULL, times};
+  struct ArrowSchema schema_double = {.format = "g", .name = "", .release = release_schema};
+  struct ArrowArray array_values = {.length = n, .null_count = 1, .n_buffers = 2, .buffers = buffers_values,
+    .release = release_array};
+  struct ArrowArray array_times = {.length = n, .n_buffers = 2, .buffers = buffers_times, .release = release_array};
+  struct ArrowSchema schema_out;
+  struct ArrowArray array_out;
+  if (arrow_rolling(rolling_sum, &schema_double, &array_values, &schema_double, &array_times, &width_before,
+    &width_after, &schema_out, &array_out) == ARROW_STATUS_OK) {
+    printf("\narrow_rolling(rolling_sum, X with a null value, %.1f, %.1f), null_count = %d\n", width_before,
+      width_after, (int) array_out.null_count);
+    print_uts((double *) array_out.buffers[1], times, n);
+    array_out.release(&array_out);
+    schema_out.release(&schema_out);
+  }
+#ifdef UTS_STATS
+  /*
+    Instrumentation counters (only if compiled with -DUTS_STATS)
+  */
+  printf("\n\n##### Instrumentation Counters #####\n\n");
+  
+  // Count the hot-path events of a rolling central moment with non-integer order, which rescans each time window
+  uts_stats stats;
+  double m = 2.5;
+  uts_stats_reset(&stats);
+  uts_stats_attach(&stats);
+  rolling_central_moment(values_rand, times_rand, &n_rand, out_approx, &width_before, &width_after, &m);
+  uts_stats_attach(NULL);
+  printf("rolling_central_moment(X_rand, %.1f, %.1f, %.1f): calls = %lld, cycles = %lld, advances = %lld, "
+    "rescans = %lld, rescan_elements = %lld, recomputations = %lld, peak_occupancy = %lld\n", width_before,
+    width_after, m, stats.calls, stats.cycles, stats.advances, stats.rescans, stats.rescan_elements,
+    stats.recomputations, stats.peak_occupancy);
+#endif
+  free(values_rand);
+  free(times_rand);
+  free(times_regular);
+  free(out_exact);
+  free(out_approx);
+
   // Wait for key pressed before exiting
   printf("\nPress <ENTER> to exit the program.\n");
   getchar();